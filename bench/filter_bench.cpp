@@ -0,0 +1,71 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// compares the direct gaussian filter against the recursive one at typical render widths
+// usage: filter_bench [iterations]
+
+#include "filter.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+template<typename F>
+static double time_us(int iterations, F&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(auto i = 0; i < iterations; ++i)
+        func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = (argc > 1) ? std::max(std::atoi(argv[1]), 1) : 200;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-120.0f, 0.0f);
+
+    std::printf("%6s %6s %12s %12s %12s %10s\n", "width", "sigma", "direct us", "fma3 us", "recursive us", "max diff");
+    for(auto width : { 800u, 1920u, 3840u })
+    {
+        std::vector<float> input(width);
+        for(auto& i : input)
+            i = dist(rng);
+
+        for(auto sigma : { RECURSIVE_GAUSS_MIN_SIGMA, 4.0f, 8.0f, 16.0f, 32.0f })  // sources filter directly below the minimum
+        {
+            const auto kernel = make_gauss_kernel(sigma);
+            auto recursive = make_recursive_gauss(sigma, width);
+            std::vector<float> direct(width), work(width), scratch;
+
+            auto t_direct = time_us(iterations, [&] { apply_filter(input, kernel, direct); });
+            auto t_fma3 = time_us(iterations, [&] { apply_filter_fma3(input, kernel, direct); });
+            auto t_recursive = time_us(iterations, [&] {
+                work = input;
+                apply_recursive_gauss(work, recursive, scratch);
+            });
+
+            auto maxdiff = 0.0f;
+            for(auto i = 0u; i < width; ++i)
+                maxdiff = std::max(maxdiff, std::abs(direct[i] - work[i]));
+
+            std::printf("%6u %6.1f %12.2f %12.2f %12.2f %10.4f\n", width, sigma, t_direct, t_fma3, t_recursive, maxdiff);
+        }
+    }
+    return 0;
+}
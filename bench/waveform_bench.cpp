@@ -0,0 +1,543 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// timings of the spectrum, meter, interpolation, filter and geometry paths on synthetic audio
+// sources are driven through the libobs stub, so this needs a HEADLESS build
+// usage: waveform_bench [filter] [frames]
+// only benchmarks with filter in their name are run, e.g. "spectrum/avx2/fft2048"
+
+#include "source.hpp"
+#include "settings.hpp"
+#include "filter.hpp"
+#include "interp_table.hpp"
+#include "math_funcs.hpp"
+#include "fft_planner.hpp"
+#include <obs-stub.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// allocation counting
+// with WRAP_MALLOC the linker routes malloc() calls from the plugin, the stub and FFTW through here,
+// which also catches avx_alloc(), otherwise only operator new is seen
+static std::atomic<uint64_t> alloc_bytes = 0;
+static std::atomic<uint64_t> alloc_count = 0;
+
+static inline void count_alloc(size_t size)
+{
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef WRAP_MALLOC
+extern "C" {
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t num, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    int __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+
+    void *__wrap_malloc(size_t size)
+    {
+        count_alloc(size);
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t num, size_t size)
+    {
+        count_alloc(num * size);
+        return __real_calloc(num, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        count_alloc(size);
+        return __real_realloc(ptr, size);
+    }
+
+    int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size)
+    {
+        count_alloc(size);
+        return __real_posix_memalign(ptr, alignment, size);
+    }
+}
+#endif
+
+void *operator new(size_t size)
+{
+#ifndef WRAP_MALLOC
+    count_alloc(size);
+#endif
+    if(auto ptr = std::malloc((size > 0) ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, [[maybe_unused]] size_t size) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, [[maybe_unused]] size_t size) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+    constexpr uint32_t SAMPLE_RATE = 48000;
+    constexpr uint32_t FPS = 60;
+    constexpr uint32_t FRAME_SAMPLES = SAMPLE_RATE / FPS;
+    constexpr uint64_t FRAME_NS = 1000000000ull / FPS;
+    constexpr auto AUDIO_SOURCE = "bench";
+
+    struct Options
+    {
+        std::string filter;
+        int frames = 300;
+    };
+
+    struct Result
+    {
+        double ns = 0.0;
+        double bytes = 0.0;
+        double allocs = 0.0;
+    };
+
+    // times func over the given number of iterations, func receives the iteration index
+    template<typename F>
+    Result measure(int iterations, F&& func)
+    {
+        const auto bytes = alloc_bytes.load();
+        const auto count = alloc_count.load();
+        const auto start = std::chrono::steady_clock::now();
+        for(auto i = 0; i < iterations; ++i)
+            func(i);
+        const auto end = std::chrono::steady_clock::now();
+        Result ret;
+        ret.ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        ret.bytes = (double)(alloc_bytes.load() - bytes) / iterations;
+        ret.allocs = (double)(alloc_count.load() - count) / iterations;
+        return ret;
+    }
+
+    void report(const std::string& name, const Result& res)
+    {
+        std::printf("%-64s %12.0f %12.1f %10.2f\n", name.c_str(), res.ns, res.bytes, res.allocs);
+        std::fflush(stdout);
+    }
+
+    // a few tones over noise, different per channel
+    // one second is generated up front and looped, so generating it doesn't show up in the timings
+    class SignalGenerator
+    {
+        std::vector<float> m_buf[2];
+        size_t m_pos = 0;
+
+    public:
+        SignalGenerator()
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+            for(auto& i : m_buf)
+                i.resize(SAMPLE_RATE);
+            for(auto i = 0u; i < SAMPLE_RATE; ++i)
+            {
+                const auto t = (double)i / SAMPLE_RATE;
+                const auto tones = 0.3 * std::sin(2 * M_PI * 110 * t) + 0.2 * std::sin(2 * M_PI * 1000 * t) + 0.1 * std::sin(2 * M_PI * 7500 * t);
+                m_buf[0][i] = (float)tones + noise(rng);
+                m_buf[1][i] = (float)(0.5 * tones) + noise(rng);
+            }
+        }
+
+        // FRAME_SAMPLES divides SAMPLE_RATE, so frames never straddle the loop point
+        void next(const float *planes[2])
+        {
+            planes[0] = &m_buf[0][m_pos];
+            planes[1] = &m_buf[1][m_pos];
+            m_pos = (m_pos + FRAME_SAMPLES) % SAMPLE_RATE;
+        }
+    };
+
+    enum class ISA
+    {
+        AVX2,
+        AVX,
+        SSE2
+    };
+
+    const char *isa_name(ISA isa)
+    {
+        switch(isa)
+        {
+        case ISA::AVX2: return "avx2";
+        case ISA::AVX: return "avx";
+        default: return "sse2";
+        }
+    }
+
+    std::vector<ISA> available_isas()
+    {
+        std::vector<ISA> ret;
+        if(WAVSource::HAVE_AVX2)
+            ret.push_back(ISA::AVX2);
+        if(WAVSource::HAVE_AVX)
+            ret.push_back(ISA::AVX);
+        ret.push_back(ISA::SSE2);
+        return ret;
+    }
+
+    // a source of the given ISA, fed by the stub audio source
+    class BenchSource
+    {
+        obs_data_t *m_settings = nullptr;
+        std::unique_ptr<WAVSource> m_source;
+        obs_source_t *m_audio = nullptr;
+        SignalGenerator m_signal;
+        uint64_t m_frame_time = 0;
+
+    public:
+        BenchSource(ISA isa, obs_data_t *settings) : m_settings(settings)
+        {
+            m_audio = obs_stub_create_audio_source(AUDIO_SOURCE);
+            switch(isa)
+            {
+            case ISA::AVX2: m_source = std::make_unique<WAVSourceAVX2>(settings, nullptr); break;
+            case ISA::AVX: m_source = std::make_unique<WAVSourceAVX>(settings, nullptr); break;
+            default: m_source = std::make_unique<WAVSourceSSE2>(settings, nullptr); break;
+            }
+        }
+
+        ~BenchSource()
+        {
+            m_source.reset();
+            obs_data_release(m_settings);
+        }
+
+        void tick()
+        {
+            const float *planes[2];
+            m_signal.next(planes);
+            obs_stub_push_source_audio(m_audio, planes, FRAME_SAMPLES, false);
+            m_frame_time += FRAME_NS;
+            obs_stub_set_frame_time(m_frame_time);
+            m_source->tick(1.0f / FPS);
+        }
+
+        void render()
+        {
+            obs_enter_graphics();
+            m_source->render(nullptr);
+            obs_leave_graphics();
+        }
+    };
+
+    obs_data_t *default_settings()
+    {
+        auto settings = obs_data_create();
+        const auto info = obs_stub_find_source_info(MODULE_NAME "_source");
+        info->get_defaults(settings);
+        obs_data_set_string(settings, P_AUDIO_SRC, AUDIO_SOURCE);
+        return settings;
+    }
+
+    bool selected(const Options& opts, const std::string& name)
+    {
+        return opts.filter.empty() || (name.find(opts.filter) != std::string::npos);
+    }
+
+    // the ISA selects the WAVSource variant, the shared analysis engine always uses the best one available
+    void bench_spectrum(const Options& opts)
+    {
+        const char *windows[] = { P_NONE, P_HANN, P_HAMMING, P_BLACKMAN, P_BLACKMAN_HARRIS };
+        const char *smoothing[] = { P_NONE, P_EXPAVG };
+        for(auto isa : available_isas())
+        {
+            for(auto fft_size = 128; fft_size <= 16384; fft_size *= 2)
+            {
+                for(auto channels : { P_MONO, P_STEREO })
+                {
+                    for(auto window : windows)
+                    {
+                        for(auto tsmooth : smoothing)
+                        {
+                            const auto name = std::string("spectrum/") + isa_name(isa) + "/fft" + std::to_string(fft_size) + "/" + channels + "/" + window + "/" + tsmooth;
+                            if(!selected(opts, name))
+                                continue;
+
+                            auto settings = default_settings();
+                            obs_data_set_int(settings, P_FFT_SIZE, fft_size);
+                            obs_data_set_string(settings, P_CHANNEL_MODE, channels);
+                            obs_data_set_string(settings, P_WINDOW, window);
+                            obs_data_set_string(settings, P_TSMOOTHING, tsmooth);
+                            BenchSource src(isa, settings);
+
+                            // fill the capture buffer before measuring
+                            const auto warmup = (int)(fft_size / FRAME_SAMPLES) + 10;
+                            for(auto i = 0; i < warmup; ++i)
+                                src.tick();
+                            report(name, measure(opts.frames, [&](int) { src.tick(); }));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void bench_meter(const Options& opts)
+    {
+        for(auto isa : available_isas())
+        {
+            for(auto rms : { true, false })
+            {
+                for(auto channels : { P_MONO, P_STEREO })
+                {
+                    const auto name = std::string("meter/") + isa_name(isa) + "/" + (rms ? "rms" : "peak") + "/" + channels;
+                    if(!selected(opts, name))
+                        continue;
+
+                    auto settings = default_settings();
+                    obs_data_set_string(settings, P_DISPLAY_MODE, P_LEVEL_METER);
+                    obs_data_set_bool(settings, P_RMS_MODE, rms);
+                    obs_data_set_string(settings, P_CHANNEL_MODE, channels);
+                    BenchSource src(isa, settings);
+                    for(auto i = 0; i < 30; ++i)
+                        src.tick();
+                    report(name, measure(opts.frames, [&](int) { src.tick(); }));
+                }
+            }
+        }
+    }
+
+    void bench_interp(const Options& opts)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        const auto iterations = opts.frames * 10;
+        for(auto fft_size : { 2048u, 8192u })
+        {
+            const auto len = fft_size / 2;
+            std::vector<float> spectrum(len);
+            for(auto& i : spectrum)
+                i = dist(rng);
+
+            for(auto width : { 400u, 800u, 1920u, 3840u })
+            {
+                // log spaced positions from 30Hz to 17.5kHz, as the curve display uses by default
+                const auto lowbin = 30.0f * fft_size / SAMPLE_RATE;
+                const auto highbin = std::min(17500.0f * fft_size / SAMPLE_RATE, (float)(len - 1));
+                std::vector<float> positions(width), out(width);
+                for(auto i = 0u; i < width; ++i)
+                    positions[i] = log_interp(lowbin, highbin, (float)i / (float)(width - 1));
+                const auto suffix = "/fft" + std::to_string(fft_size) + "/w" + std::to_string(width);
+
+                auto name = "interp/lanczos_interp" + suffix;
+                if(selected(opts, name))
+                {
+                    report(name, measure(iterations, [&](int) {
+                        for(auto i = 0u; i < width; ++i)
+                            out[i] = lanczos_interp(positions[i], 3.0f, len, spectrum.data());
+                    }));
+                }
+
+                const auto table = make_lanczos_table(positions.data(), width, len, 3.0f);
+                name = "interp/table" + suffix;
+                if(selected(opts, name))
+                    report(name, measure(iterations, [&](int) { apply_interp(table, spectrum.data(), out.data()); }));
+
+                name = "interp/table_avx2" + suffix;
+                if(WAVSource::HAVE_AVX2 && selected(opts, name))
+                    report(name, measure(iterations, [&](int) { apply_interp_avx2(table, spectrum.data(), out.data()); }));
+            }
+
+            for(auto bars : { 32u, 128u })
+            {
+                // interpolated at every whole bin step within each bar, as the bar display does
+                const auto lowbin = 30.0f * fft_size / SAMPLE_RATE;
+                const auto highbin = std::min(17500.0f * fft_size / SAMPLE_RATE, (float)(len - 1));
+                std::vector<float> positions;
+                std::vector<uint32_t> bar_points;
+                for(auto i = 0u; i < bars; ++i)
+                {
+                    bar_points.push_back((uint32_t)positions.size());
+                    auto pos = log_interp(lowbin, highbin, (float)i / (float)bars);
+                    const auto stop = log_interp(lowbin, highbin, (float)(i + 1) / (float)bars);
+                    do
+                    {
+                        positions.push_back(pos);
+                        pos += 1.0f;
+                    } while(pos < stop);
+                }
+                bar_points.push_back((uint32_t)positions.size());
+                std::vector<float> points(positions.size()), out(bars);
+                const auto suffix = "/fft" + std::to_string(fft_size) + "/bars" + std::to_string(bars);
+
+                // every position through the lanczos table, then averaged per bar
+                const auto table = make_lanczos_table(positions.data(), positions.size(), len, 3.0f);
+                auto name = "interp/bars_table_avx2" + suffix;
+                if(WAVSource::HAVE_AVX2 && selected(opts, name))
+                {
+                    report(name, measure(iterations, [&](int) {
+                        apply_interp_avx2(table, spectrum.data(), points.data());
+                        for(auto i = 0u; i < bars; ++i)
+                        {
+                            float sum = 0.0f;
+                            for(auto j = bar_points[i]; j < bar_points[i + 1]; ++j)
+                                sum += points[j];
+                            out[i] = sum / (float)(bar_points[i + 1] - bar_points[i]);
+                        }
+                    }));
+                }
+
+                const auto matrix = make_band_matrix(table, bar_points, true);
+                name = "interp/bars_matrix" + suffix;
+                if(selected(opts, name))
+                    report(name, measure(iterations, [&](int) { apply_band_matrix<false>(matrix, spectrum.data(), out.data()); }));
+
+                name = "interp/bars_matrix_avx2" + suffix;
+                if(WAVSource::HAVE_AVX2 && selected(opts, name))
+                    report(name, measure(iterations, [&](int) { apply_band_matrix_avx2<false>(matrix, spectrum.data(), out.data()); }));
+
+                name = "interp/bars_energy_avx2" + suffix;
+                if(WAVSource::HAVE_AVX2 && selected(opts, name))
+                    report(name, measure(iterations, [&](int) { apply_band_matrix_avx2<true>(matrix, spectrum.data(), out.data()); }));
+            }
+        }
+    }
+
+    void bench_filter(const Options& opts)
+    {
+        if(!WAVSource::HAVE_FMA3)
+            return;
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(-120.0f, 0.0f);
+        const auto iterations = opts.frames * 10;
+        for(auto width : { 400u, 800u, 1920u, 3840u })
+        {
+            std::vector<float> input(width), output(width);
+            for(auto& i : input)
+                i = dist(rng);
+            for(auto radius : { 1.5f, 4.0f, 8.0f, 16.0f })
+            {
+                char name[64];
+                std::snprintf(name, sizeof(name), "filter/apply_filter_fma3/w%u/r%.1f", width, radius);
+                if(!selected(opts, name))
+                    continue;
+                const auto kernel = make_gauss_kernel(radius);
+                report(name, measure(iterations, [&](int) { apply_filter_fma3(input, kernel, output); }));
+            }
+        }
+    }
+
+    void bench_geometry(const Options& opts)
+    {
+        struct Layout
+        {
+            const char *name;
+            const char *display;
+            const char *render;
+            bool caps;
+            bool radial;
+        };
+        const Layout layouts[] = {
+            { "curve_line", P_CURVE, P_LINE, false, false },
+            { "curve_solid", P_CURVE, P_SOLID, false, false },
+            { "bars", P_BARS, P_SOLID, false, false },
+            { "bars_caps", P_BARS, P_SOLID, true, false },
+            { "bars_radial", P_BARS, P_SOLID, false, true },
+            { "stepped_bars", P_STEP_BARS, P_SOLID, false, false },
+            { "level_meter", P_LEVEL_METER, P_SOLID, false, false },
+            { "stepped_level_meter", P_STEPPED_METER, P_SOLID, false, false }
+        };
+
+        const auto isa = available_isas().front();
+        for(const auto& layout : layouts)
+        {
+            for(auto channels : { P_MONO, P_STEREO })
+            {
+                for(auto width : { 800u, 1920u })
+                {
+                    const auto name = std::string("geometry/") + layout.name + "/" + channels + "/w" + std::to_string(width);
+                    if(!selected(opts, name))
+                        continue;
+
+                    auto settings = default_settings();
+                    obs_data_set_string(settings, P_DISPLAY_MODE, layout.display);
+                    obs_data_set_string(settings, P_RENDER_MODE, layout.render);
+                    obs_data_set_bool(settings, P_CAPS, layout.caps);
+                    obs_data_set_bool(settings, P_RADIAL, layout.radial);
+                    obs_data_set_string(settings, P_CHANNEL_MODE, channels);
+                    obs_data_set_int(settings, P_WIDTH, width);
+                    BenchSource src(isa, settings);
+                    for(auto i = 0; i < 30; ++i)
+                        src.tick();
+                    src.render(); // creates the shared effect and the vertex buffer
+                    report(name, measure(opts.frames, [&](int) { src.render(); }));
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    if(argc > 1)
+        opts.filter = argv[1];
+    if(argc > 2)
+        opts.frames = std::max(std::atoi(argv[2]), 1);
+
+    obs_stub_set_log_level(LOG_WARNING);
+    obs_stub_set_audio_info(SAMPLE_RATE, SPEAKERS_STEREO);
+    obs_stub_set_video_fps(FPS, 1);
+    WAVSource::register_source();
+
+    // background FFTW_MEASURE planning would compete with the benchmarks, stick to the initial plans
+    FFTPlanner::get().shutdown();
+
+    std::printf("%-64s %12s %12s %10s\n", "benchmark", "ns/frame", "bytes/frame", "allocs");
+    bench_spectrum(opts);
+    bench_meter(opts);
+    bench_interp(opts);
+    bench_filter(opts);
+    bench_geometry(opts);
+
+    obs_enter_graphics();
+    WAVSource::free_effect();
+    obs_leave_graphics();
+    return 0;
+}
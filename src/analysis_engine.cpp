@@ -0,0 +1,365 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "waveform_config.hpp"
+#include "analysis_engine.hpp"
+#include "fft_planner.hpp"
+#include "settings.hpp"
+#include <map>
+#include <algorithm>
+#include <cstring>
+
+// Callbacks for audio capture
+namespace callbacks {
+    static void capture_audio(void *data, obs_source_t *source, const audio_data *audio, bool muted)
+    {
+        static_cast<AnalysisEngine*>(data)->capture_audio(source, audio, muted);
+    }
+
+    static void capture_output_bus(void *param, size_t mix_idx, audio_data *data)
+    {
+        static_cast<AnalysisEngine*>(param)->capture_output_bus(mix_idx, data);
+    }
+}
+
+// engines currently in use, entries expire when the last subscriber lets go
+static std::mutex registry_mtx;
+static std::map<AnalysisEngine::Key, std::weak_ptr<AnalysisEngine>> registry;
+
+std::shared_ptr<AnalysisEngine> AnalysisEngine::acquire(const Key& key)
+{
+    {
+        std::lock_guard lock(registry_mtx);
+        for(auto it = registry.begin(); it != registry.end();)
+        {
+            if(it->second.expired())
+                it = registry.erase(it);
+            else
+                ++it;
+        }
+
+        auto it = registry.find(key);
+        if(it != registry.end())
+            if(auto engine = it->second.lock())
+                return engine;
+    }
+
+    // planning and attaching the capture happen outside the lock, so acquiring other keys doesn't wait on them
+    std::shared_ptr<AnalysisEngine> engine;
+    if(key.simd == SIMDLevel::AVX2)
+        engine = std::make_shared<AnalysisEngineAVX2>(key);
+    else if(key.simd == SIMDLevel::AVX)
+        engine = std::make_shared<AnalysisEngineAVX>(key);
+    else if(key.simd == SIMDLevel::SSE2)
+        engine = std::make_shared<AnalysisEngineSSE2>(key);
+    else
+        engine = std::make_shared<AnalysisEngineScalar>(key);
+
+    // another thread may have created the same engine in the meantime, ours is released outside the lock
+    std::shared_ptr<AnalysisEngine> existing;
+    {
+        std::lock_guard lock(registry_mtx);
+        auto& entry = registry[key];
+        existing = entry.lock();
+        if(existing == nullptr)
+            entry = engine;
+    }
+    if(existing != nullptr)
+        return existing;
+
+    if((key.fft_size > 0) && !engine->m_plan_measured)
+        FFTPlanner::get().request_measured(key.fft_size, engine);
+    return engine;
+}
+
+AnalysisEngine::AnalysisEngine(const Key& key) : m_key(key)
+{
+    const auto fft_size = m_key.fft_size;
+    if(fft_size > 0)
+    {
+        m_fft_input.reset(avx_alloc<float>(fft_size));
+        m_fft_output.reset(avx_alloc<fftwf_complex>(fft_size));
+        m_fft_plan = FFTPlanner::get().plan_r2c(fft_size, m_fft_input.get(), m_fft_output.get(), m_plan_measured);
+        for(auto i = 0u; i < m_key.channels; ++i)
+        {
+            m_magnitudes[i].reset(avx_alloc<float>(fft_size / 2));
+            memset(m_magnitudes[i].get(), 0, (fft_size / 2) * sizeof(float));
+        }
+
+        // window function
+        if(m_key.window != FFTWindow::NONE)
+        {
+            // precompute window coefficients
+            m_window_coefficients.reset(avx_alloc<float>(fft_size));
+            const auto N = fft_size - 1;
+            constexpr auto pi2 = 2 * (float)M_PI;
+            constexpr auto pi4 = 4 * (float)M_PI;
+            constexpr auto pi6 = 6 * (float)M_PI;
+            switch(m_key.window)
+            {
+            case FFTWindow::HAMMING:
+                for(size_t i = 0; i < fft_size; ++i)
+                    m_window_coefficients[i] = 0.53836f - (0.46164f * std::cos((pi2 * i) / N));
+                break;
+
+            case FFTWindow::BLACKMAN:
+                for(size_t i = 0; i < fft_size; ++i)
+                    m_window_coefficients[i] = 0.42f - (0.5f * std::cos((pi2 * i) / N)) + (0.08f * std::cos((pi4 * i) / N));
+                break;
+
+            case FFTWindow::BLACKMAN_HARRIS:
+                for(size_t i = 0; i < fft_size; ++i)
+                    m_window_coefficients[i] = 0.35875f - (0.48829f * std::cos((pi2 * i) / N)) + (0.14128f * std::cos((pi4 * i) / N)) - (0.01168f * std::cos((pi6 * i) / N));
+                break;
+
+            case FFTWindow::HANN:
+            default:
+                for(size_t i = 0; i < fft_size; ++i)
+                    m_window_coefficients[i] = 0.5f * (1 - std::cos((pi2 * i) / N));
+                break;
+            }
+        }
+    }
+    else
+    {
+        // enough history for the largest meter buffer (1 second)
+        m_history_size = 64;
+        while(m_history_size < m_key.sample_rate)
+            m_history_size <<= 1;
+        for(auto i = 0u; i < m_key.channels; ++i)
+        {
+            m_history[i].reset(avx_alloc<float>(m_history_size));
+            memset(m_history[i].get(), 0, m_history_size * sizeof(float));
+        }
+    }
+
+    // capture buffers must hold a full window (plus pending hops) and the audio that arrives between video frames
+    // the audio thread is not attached yet, so it is safe to prefill them
+    for(auto& i : m_capturebufs)
+    {
+        i.reset((fft_size * 2) + (m_key.hop_size * MAX_HOPS) + (m_key.sample_rate / (4 * m_key.decimation)));
+        i.push_back_zero(fft_size);
+    }
+    for(auto& i : m_decimators)
+        i.reset(m_key.decimation);
+
+    recapture_audio();
+}
+
+AnalysisEngine::~AnalysisEngine()
+{
+    release_audio_capture();
+    FFTPlanner::get().destroy_plan(m_fft_plan);
+}
+
+fftwf_plan AnalysisEngine::swap_plan(fftwf_plan plan, bool measured)
+{
+    std::lock_guard lock(m_mtx);
+    if(plan == nullptr)
+        return nullptr;
+    m_plan_measured = measured;
+    std::swap(plan, m_fft_plan);
+    return plan;
+}
+
+bool AnalysisEngine::has_plan()
+{
+    std::lock_guard lock(m_mtx);
+    return m_fft_plan != nullptr;
+}
+
+void AnalysisEngine::recapture_audio()
+{
+    // release old capture
+    release_audio_capture();
+
+    // add new capture
+    auto src_name = m_key.audio_source.c_str();
+    if(p_equ(src_name, P_OUTPUT_BUS))
+    {
+        obs_audio_info info;
+        auto speakers = obs_get_audio_info(&info) ? info.speakers : speaker_layout::SPEAKERS_UNKNOWN;
+        audio_convert_info cvt{};
+        cvt.format = audio_format::AUDIO_FORMAT_FLOAT_PLANAR;
+        cvt.samples_per_sec = m_key.sample_rate;
+        cvt.speakers = (speakers != speaker_layout::SPEAKERS_UNKNOWN) ? speakers : speaker_layout::SPEAKERS_STEREO;
+        m_output_bus_captured = audio_output_connect(obs_get_audio(), 0, &cvt, &callbacks::capture_output_bus, this);
+    }
+    else
+    {
+        auto asrc = obs_get_source_by_name(src_name);
+        if(asrc != nullptr)
+        {
+            obs_source_add_audio_capture_callback(asrc, &callbacks::capture_audio, this);
+            m_audio_source = obs_source_get_weak_source(asrc);
+            obs_source_release(asrc);
+        }
+        else if(!p_equ(src_name, "none"))
+        {
+            if(m_retries++ == 0)
+                blog(LOG_WARNING, "[" MODULE_NAME "]: Failed to get audio source: \"%s\"", src_name);
+        }
+    }
+}
+
+void AnalysisEngine::release_audio_capture()
+{
+    bool released = false;
+    if(m_audio_source != nullptr)
+    {
+        released = true;
+        auto src = obs_weak_source_get_source(m_audio_source);
+        obs_weak_source_release(m_audio_source);
+        m_audio_source = nullptr;
+        if(src != nullptr)
+        {
+            obs_source_remove_audio_capture_callback(src, &callbacks::capture_audio, this);
+            obs_source_release(src);
+        }
+    }
+
+    if(m_output_bus_captured)
+    {
+        released = true;
+        audio_output_disconnect(obs_get_audio(), 0, &callbacks::capture_output_bus, this);
+        m_output_bus_captured = false;
+    }
+
+    // reset circular buffers
+    // removing the callbacks flushes them, so the audio thread is no longer writing to these
+    if(released)
+        for(auto& i : m_capturebufs)
+            i.clear();
+}
+
+bool AnalysisEngine::check_audio_capture(float seconds)
+{
+    if(m_output_bus_captured)
+        return true;
+
+    if(m_audio_source == nullptr)
+    {
+        m_next_retry -= seconds;
+        if(m_next_retry <= 0.0f)
+        {
+            m_next_retry = RETRY_DELAY;
+            recapture_audio();
+            if(m_audio_source != nullptr)
+                return true;
+        }
+        return false;
+    }
+
+    // check if the source still exists
+    auto src = obs_weak_source_get_source(m_audio_source);
+    if(src == nullptr)
+    {
+        release_audio_capture();
+        return false;
+    }
+    obs_source_release(src);
+    return true;
+}
+
+bool AnalysisEngine::process(uint64_t frame_time, float seconds, bool analyze, StageClock& clock)
+{
+    if(frame_time != m_last_frame)
+    {
+        m_last_frame = frame_time;
+        m_capturing = check_audio_capture(seconds);
+        if(m_capturing)
+        {
+            clock.begin(Stage::CAPTURE);
+            if(m_key.fft_size > 0)
+            {
+                // discard everything but the newest window, which is left in the buffer to overlap with the next frame
+                // with a hop size, keep the windows that arrived since the last frame for analyze_spectrum() to step through
+                const auto keep = m_key.fft_size + (m_key.hop_size * (MAX_HOPS - 1));
+                for(auto channel = 0u; channel < m_key.channels; ++channel)
+                {
+                    const auto avail = m_capturebufs[channel].size();
+                    if(avail > keep)
+                        m_capturebufs[channel].pop_front(nullptr, avail - keep);
+                }
+            }
+            else
+                drain_history();
+            clock.end();
+        }
+    }
+
+    if(analyze && m_capturing && (m_key.fft_size > 0) && (frame_time != m_last_analyzed))
+    {
+        m_last_analyzed = frame_time;
+        analyze_spectrum(clock);
+    }
+
+    return m_capturing;
+}
+
+void AnalysisEngine::drain_history()
+{
+    // all channels are drained in lockstep so that history positions line up
+    auto consume = m_capturebufs[0].size();
+    for(auto channel = 1u; channel < m_key.channels; ++channel)
+        consume = std::min(consume, m_capturebufs[channel].size());
+
+    // only the newest second of audio can be kept anyway
+    if(consume > m_history_size)
+    {
+        for(auto channel = 0u; channel < m_key.channels; ++channel)
+            m_capturebufs[channel].pop_front(nullptr, consume - m_history_size);
+        m_history_total += consume - m_history_size;
+        consume = m_history_size;
+    }
+
+    while(consume > 0)
+    {
+        const auto pos = (size_t)(m_history_total & (m_history_size - 1));
+        const auto count = std::min(consume, m_history_size - pos);
+        for(auto channel = 0u; channel < m_key.channels; ++channel)
+            m_capturebufs[channel].pop_front(&m_history[channel][pos], count);
+        m_history_total += count;
+        consume -= count;
+    }
+}
+
+void AnalysisEngine::read_history(uint32_t channel, uint64_t start, size_t count, float *dst) const
+{
+    while(count > 0)
+    {
+        const auto pos = (size_t)(start & (m_history_size - 1));
+        const auto n = std::min(count, m_history_size - pos);
+        memcpy(dst, &m_history[channel][pos], n * sizeof(float));
+        dst += n;
+        start += n;
+        count -= n;
+    }
+}
+
+// runs on the audio thread, must never block
+void AnalysisEngine::capture_audio([[maybe_unused]] obs_source_t *source, const audio_data *audio, bool muted)
+{
+    for(auto i = 0u; i < m_key.channels; ++i)
+        m_decimators[i].push(muted ? nullptr : (const float*)audio->data[i], audio->frames, m_capturebufs[i]);
+}
+
+void AnalysisEngine::capture_output_bus([[maybe_unused]] size_t mix_idx, const audio_data *audio)
+{
+    for(auto i = 0u; i < m_key.channels; ++i)
+        m_decimators[i].push((const float*)audio->data[i], audio->frames, m_capturebufs[i]);
+}
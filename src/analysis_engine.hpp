@@ -0,0 +1,198 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "source.hpp"
+#include <mutex>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <cstdint>
+#include "ring_buffer.hpp"
+#include "decimator.hpp"
+#include "stage_stats.hpp"
+
+// audio capture and FFT shared by every WAVSource watching the same input with the same parameters
+// capture happens once and the FFT runs at most once per video frame no matter how many sources subscribe
+// subscribers read the normalized magnitude spectra (or raw samples in meter mode) and keep their own
+// smoothing, interpolation and render state
+class AnalysisEngine
+{
+public:
+    struct Key
+    {
+        std::string audio_source;
+        uint32_t sample_rate = 0;
+        uint32_t channels = 0;
+        size_t fft_size = 0;    // 0 for raw sample capture (meter mode)
+        uint32_t decimation = 1; // audio is low-passed and downsampled by this before capture, sizes count the downsampled samples
+        FFTWindow window = FFTWindow::NONE;
+        size_t hop_size = 0;    // 0 to analyze only the newest window each frame
+        HopCombine combine = HopCombine::AVERAGE;
+        SIMDLevel simd = SIMDLevel::SCALAR; // same as the subscribing source, so its output only depends on its own kernels
+        bool power = false;     // output normalized power (the square of the magnitude) instead of magnitude
+        float gate = 0.0f;      // windows with no sample louder than this skip the FFT and count as silence
+
+        bool operator<(const Key& other) const
+        {
+            return std::tie(audio_source, sample_rate, channels, fft_size, decimation, window, hop_size, combine, simd, power, gate) < std::tie(other.audio_source, other.sample_rate, other.channels, other.fft_size, other.decimation, other.window, other.hop_size, other.combine, other.simd, other.power, other.gate);
+        }
+
+        bool operator==(const Key& other) const
+        {
+            return std::tie(audio_source, sample_rate, channels, fft_size, decimation, window, hop_size, combine, simd, power, gate) == std::tie(other.audio_source, other.sample_rate, other.channels, other.fft_size, other.decimation, other.window, other.hop_size, other.combine, other.simd, other.power, other.gate);
+        }
+    };
+
+protected:
+    // guards everything below, subscribers hold it while reading results
+    std::mutex m_mtx;
+
+    const Key m_key;
+
+    // obs sources
+    obs_weak_source_t *m_audio_source = nullptr;    // captured audio source
+    bool m_output_bus_captured = false;             // do we have an active audio output callback? (via audio_output_connect())
+
+    // audio capture retries
+    int m_retries = 0;
+    float m_next_retry = 0.0f;
+
+    // audio capture
+    RingBuffer m_capturebufs[2];    // written by the audio thread, read by process()
+    Decimator m_decimators[2];      // only used by the audio thread
+    bool m_capturing = false;       // result of the last capture check
+
+    // frame tracking, process() does its work at most once per video frame
+    uint64_t m_last_frame = UINT64_MAX;
+    uint64_t m_last_analyzed = UINT64_MAX;
+
+    // 32-byte aligned buffers for FFT/AVX processing
+    AVXBufR m_fft_input;
+    AVXBufC m_fft_output;
+    fftwf_plan m_fft_plan{};        // estimated (or none) until the planner swaps in a measured plan
+    // stereo runs this real plan once per channel, packing both channels into one complex FFT doesn't pay off
+    // FFTW already computes r2c through a half length complex FFT, so the packed transform costs the same as the two
+    // real ones and the separation pass comes on top (measured equal with measured plans, slower with estimated ones)
+    bool m_plan_measured = false;
+    AVXBufR m_window_coefficients;
+    AVXBufR m_magnitudes[2];        // normalized magnitudes (2 * magnitude / N), squared if m_key.power
+    bool m_has_data[2] = { false, false };
+    bool m_silent[2] = { false, false };
+
+    // most hops analyzed in one frame, anything older is dropped after a stall
+    static constexpr size_t MAX_HOPS = 32;
+
+    // raw sample history (meter mode)
+    AVXBufR m_history[2];
+    size_t m_history_size = 0;      // power of 2
+    uint64_t m_history_total = 0;   // samples written since creation
+
+    void recapture_audio();
+    void release_audio_capture();
+    bool check_audio_capture(float seconds); // check if capture is valid and retry if not
+
+    void drain_history();
+    virtual void analyze_spectrum(StageClock& clock) = 0;    // window, FFT and magnitude of the pending window(s) of each channel
+
+    static constexpr auto RETRY_DELAY = 2.0f;
+
+public:
+    explicit AnalysisEngine(const Key& key);
+    virtual ~AnalysisEngine();
+
+    // no copying
+    AnalysisEngine(const AnalysisEngine&) = delete;
+    AnalysisEngine& operator=(const AnalysisEngine&) = delete;
+
+    // get the engine for key, creating it if no other source is using it
+    // new engines without a measured plan queue one with the FFTPlanner
+    static std::shared_ptr<AnalysisEngine> acquire(const Key& key);
+
+    std::mutex& mutex() { return m_mtx; }
+
+    // everything below requires mutex() to be held
+
+    // consume captured audio and, if analyze is set, compute the spectrum
+    // repeated calls for the same frame_time are no-ops, so every subscriber may call this each tick
+    // returns false if the audio source isn't being captured
+    // the work is timed on the caller's clock, so it is attributed to the subscriber that paid for it
+    bool process(uint64_t frame_time, float seconds, bool analyze, StageClock& clock);
+
+    // replace the FFT plan, returns the old one for the caller to destroy
+    // takes the mutex itself
+    fftwf_plan swap_plan(fftwf_plan plan, bool measured);
+
+    // false until the planner hands over a plan if it was busy measuring on creation, nothing is analyzed until then
+    // takes the mutex itself
+    bool has_plan();
+
+    const Key& key() const { return m_key; }
+    bool has_data(uint32_t channel) const { return m_has_data[channel]; }   // a full window was available
+    bool silent(uint32_t channel) const { return m_silent[channel]; }       // every window was below the gate
+    const float *magnitudes(uint32_t channel) const { return m_magnitudes[channel].get(); } // powers if key().power
+
+    // raw samples in meter mode, positions are in terms of history_total()
+    uint64_t history_total() const { return m_history_total; }
+    size_t history_size() const { return m_history_size; }
+    void read_history(uint32_t channel, uint64_t start, size_t count, float *dst) const;
+
+    // audio callbacks
+    void capture_audio(obs_source_t *source, const audio_data *audio, bool muted);
+    void capture_output_bus(size_t mix_idx, const audio_data *audio);
+};
+
+class AnalysisEngineAVX2 : public AnalysisEngine
+{
+public:
+    using AnalysisEngine::AnalysisEngine;
+    ~AnalysisEngineAVX2() override {}
+
+protected:
+    void analyze_spectrum(StageClock& clock) override;
+};
+
+class AnalysisEngineAVX : public AnalysisEngine
+{
+public:
+    using AnalysisEngine::AnalysisEngine;
+    ~AnalysisEngineAVX() override {}
+
+protected:
+    void analyze_spectrum(StageClock& clock) override;
+};
+
+class AnalysisEngineSSE2 : public AnalysisEngine
+{
+public:
+    using AnalysisEngine::AnalysisEngine;
+    ~AnalysisEngineSSE2() override {}
+
+protected:
+    void analyze_spectrum(StageClock& clock) override;
+};
+
+// reference for the SIMD engines, see WAVSourceScalar
+class AnalysisEngineScalar : public AnalysisEngine
+{
+public:
+    using AnalysisEngine::AnalysisEngine;
+    ~AnalysisEngineScalar() override {}
+
+protected:
+    void analyze_spectrum(StageClock& clock) override;
+};
@@ -0,0 +1,165 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "waveform_config.hpp"
+#include "analysis_engine.hpp"
+#include <immintrin.h>
+#include <cmath>
+#include <cstring>
+
+// copy count samples out of the capture buffer into dst, multiplying them by the window coefficients if WINDOWED
+// returns true if no sample is louder than gate (0 for digital silence only), checked on the way through instead of in a separate pass
+// ring positions are arbitrary, so the loads and stores are unaligned
+template<bool WINDOWED>
+DECORATE_AVX
+static bool window_copy_avx(const RingBuffer& capbuf, float *dst, const float *coefficients, size_t count, float gate)
+{
+    constexpr auto step = sizeof(__m256) / sizeof(float);
+    const float *runs[2];
+    const auto first = capbuf.peek_runs(count, runs);
+    const auto sign = _mm256_set1_ps(-0.0f);
+    const auto threshold = _mm256_set1_ps(gate);
+    auto loud = _mm256_setzero_ps();
+    bool loud_tail = false;
+    size_t offset = 0;
+    for(auto run = 0; run < 2; ++run)
+    {
+        const auto src = runs[run];
+        const auto len = (run == 0) ? first : count - first;
+        size_t i = 0;
+        for(; i + step <= len; i += step)
+        {
+            auto samples = _mm256_loadu_ps(&src[i]);
+            loud = _mm256_or_ps(loud, _mm256_cmp_ps(_mm256_andnot_ps(sign, samples), threshold, _CMP_NLE_UQ));
+            if constexpr(WINDOWED)
+                samples = _mm256_mul_ps(samples, _mm256_loadu_ps(&coefficients[offset + i]));
+            _mm256_storeu_ps(&dst[offset + i], samples);
+        }
+        for(; i < len; ++i)
+        {
+            loud_tail |= !(std::abs(src[i]) <= gate);
+            dst[offset + i] = WINDOWED ? src[i] * coefficients[offset + i] : src[i];
+        }
+        offset += len;
+    }
+
+    // compared as not less or equal, so -0.0 counts as silent and NaN doesn't
+    return !loud_tail && (_mm256_movemask_ps(loud) == 0);
+}
+
+// adaptation of AnalysisEngineAVX2 to support CPUs without AVX2
+// see comments of AnalysisEngineAVX2
+DECORATE_AVX
+void AnalysisEngineAVX::analyze_spectrum(StageClock& clock)
+{
+    const auto fft_size = m_key.fft_size;
+    const auto hop_size = m_key.hop_size;
+    const auto outsz = fft_size / 2;
+    constexpr auto step = sizeof(__m256) / sizeof(float);
+
+    if(m_fft_plan == nullptr)
+        return;
+
+    const auto window_copy = (m_key.window != FFTWindow::NONE) ? window_copy_avx<true> : window_copy_avx<false>;
+
+    for(auto channel = 0u; channel < m_key.channels; ++channel)
+    {
+        auto& capbuf = m_capturebufs[channel];
+        auto magbuf = m_magnitudes[channel].get();
+        auto windows = 0u;
+        auto silent_windows = 0u;
+        while(capbuf.size() >= fft_size)
+        {
+            clock.begin(Stage::WINDOW);
+            const bool silent = window_copy(capbuf, m_fft_input.get(), m_window_coefficients.get(), fft_size, m_key.gate);
+            if(hop_size > 0)
+                capbuf.pop_front(nullptr, hop_size);
+
+            if(silent)
+                ++silent_windows;
+            else
+            {
+                clock.begin(Stage::FFT);
+                fftwf_execute_dft_r2c(m_fft_plan, m_fft_input.get(), m_fft_output.get());
+
+                clock.begin(Stage::MAGNITUDE);
+                constexpr auto shuffle_mask_r = 0 | (2 << 2) | (0 << 4) | (2 << 6);
+                constexpr auto shuffle_mask_i = 1 | (3 << 2) | (1 << 4) | (3 << 6);
+                for(size_t i = 0; i < outsz; i += step)
+                {
+                    // load 8 real/imaginary pairs and group the r/i components in the low/high halves
+                    // de-interleaving 256-bit float vectors is nigh impossible without AVX2, so we'll
+                    // use 128-bit vectors and merge them, but i question if this is better than a 128-bit loop
+                    const float *buf = &m_fft_output[i][0];
+                    auto chunk1 = _mm_load_ps(buf);
+                    auto chunk2 = _mm_load_ps(&buf[4]);
+                    auto rvec = _mm256_castps128_ps256(_mm_shuffle_ps(chunk1, chunk2, shuffle_mask_r)); // group octwords
+                    auto ivec = _mm256_castps128_ps256(_mm_shuffle_ps(chunk1, chunk2, shuffle_mask_i));
+                    chunk1 = _mm_load_ps(&buf[8]);
+                    chunk2 = _mm_load_ps(&buf[12]);
+                    rvec = _mm256_insertf128_ps(rvec, _mm_shuffle_ps(chunk1, chunk2, shuffle_mask_r), 1); // pack r/i octwords into separate 256-bit vecs
+                    ivec = _mm256_insertf128_ps(ivec, _mm_shuffle_ps(chunk1, chunk2, shuffle_mask_i), 1);
+
+                    auto power = _mm256_fmadd_ps(ivec, ivec, _mm256_mul_ps(rvec, rvec));
+                    if(windows > 0)
+                    {
+                        auto acc = _mm256_load_ps(&magbuf[i]);
+                        power = (m_key.combine == HopCombine::MAX) ? _mm256_max_ps(acc, power) : _mm256_add_ps(acc, power);
+                    }
+                    _mm256_store_ps(&magbuf[i], power);
+                }
+                ++windows;
+            }
+
+            if(hop_size == 0)
+                break;
+        }
+
+        if(windows + silent_windows == 0)
+            continue;
+
+        // a buffer that was already silent is still all zeroes
+        const auto was_silent = m_has_data[channel] && m_silent[channel];
+        m_has_data[channel] = true;
+        m_silent[channel] = windows == 0;
+        if(windows == 0)
+        {
+            if(!was_silent)
+                memset(magbuf, 0, outsz * sizeof(float));
+            continue;
+        }
+
+        clock.begin(Stage::MAGNITUDE);
+        auto coefficient = 2.0f / (float)fft_size;
+        if(m_key.combine != HopCombine::MAX)
+            coefficient /= std::sqrt((float)(windows + silent_windows));
+        if(m_key.power)
+        {
+            // the square of the above, no square root needed
+            const auto pow_coefficient = _mm256_set1_ps(coefficient * coefficient);
+            for(size_t i = 0; i < outsz; i += step)
+                _mm256_store_ps(&magbuf[i], _mm256_mul_ps(_mm256_load_ps(&magbuf[i]), pow_coefficient));
+        }
+        else
+        {
+            const auto mag_coefficient = _mm256_set1_ps(coefficient);
+            for(size_t i = 0; i < outsz; i += step)
+                _mm256_store_ps(&magbuf[i], _mm256_mul_ps(_mm256_sqrt_ps(_mm256_load_ps(&magbuf[i])), mag_coefficient));
+        }
+    }
+    clock.end();
+}
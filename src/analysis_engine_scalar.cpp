@@ -0,0 +1,123 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "waveform_config.hpp"
+#include "analysis_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// copy count samples out of the capture buffer into dst, multiplying them by the window coefficients if WINDOWED
+// returns true if no sample is louder than gate
+template<bool WINDOWED>
+static bool window_copy_scalar(const RingBuffer& capbuf, float *dst, const float *coefficients, size_t count, float gate)
+{
+    const float *runs[2];
+    const auto first = capbuf.peek_runs(count, runs);
+    bool silent = true;
+    for(size_t i = 0; i < count; ++i)
+    {
+        const auto sample = (i < first) ? runs[0][i] : runs[1][i - first];
+        if(!(std::abs(sample) <= gate))
+            silent = false;
+        dst[i] = WINDOWED ? sample * coefficients[i] : sample;
+    }
+    return silent;
+}
+
+// plain C++ version of AnalysisEngineAVX2 without any intrinsics
+// see comments of AnalysisEngineAVX2
+void AnalysisEngineScalar::analyze_spectrum(StageClock& clock)
+{
+    const auto fft_size = m_key.fft_size;
+    const auto hop_size = m_key.hop_size;
+    const auto outsz = fft_size / 2;
+
+    if(m_fft_plan == nullptr)
+        return;
+
+    const auto window_copy = (m_key.window != FFTWindow::NONE) ? window_copy_scalar<true> : window_copy_scalar<false>;
+
+    for(auto channel = 0u; channel < m_key.channels; ++channel)
+    {
+        auto& capbuf = m_capturebufs[channel];
+        auto magbuf = m_magnitudes[channel].get();
+        auto windows = 0u;
+        auto silent_windows = 0u;
+        while(capbuf.size() >= fft_size)
+        {
+            clock.begin(Stage::WINDOW);
+            const bool silent = window_copy(capbuf, m_fft_input.get(), m_window_coefficients.get(), fft_size, m_key.gate);
+            if(hop_size > 0)
+                capbuf.pop_front(nullptr, hop_size);
+
+            if(silent)
+                ++silent_windows;
+            else
+            {
+                clock.begin(Stage::FFT);
+                fftwf_execute_dft_r2c(m_fft_plan, m_fft_input.get(), m_fft_output.get());
+
+                clock.begin(Stage::MAGNITUDE);
+                for(size_t i = 0; i < outsz; ++i)
+                {
+                    const auto r = m_fft_output[i][0];
+                    const auto im = m_fft_output[i][1];
+                    auto power = (im * im) + (r * r);
+                    if(windows > 0)
+                        power = (m_key.combine == HopCombine::MAX) ? std::max(magbuf[i], power) : magbuf[i] + power;
+                    magbuf[i] = power;
+                }
+                ++windows;
+            }
+
+            if(hop_size == 0)
+                break;
+        }
+
+        if(windows + silent_windows == 0)
+            continue;
+
+        // a buffer that was already silent is still all zeroes
+        const auto was_silent = m_has_data[channel] && m_silent[channel];
+        m_has_data[channel] = true;
+        m_silent[channel] = windows == 0;
+        if(windows == 0)
+        {
+            if(!was_silent)
+                memset(magbuf, 0, outsz * sizeof(float));
+            continue;
+        }
+
+        clock.begin(Stage::MAGNITUDE);
+        auto coefficient = 2.0f / (float)fft_size;
+        if(m_key.combine != HopCombine::MAX)
+            coefficient /= std::sqrt((float)(windows + silent_windows));
+        if(m_key.power)
+        {
+            const auto pow_coefficient = coefficient * coefficient;
+            for(size_t i = 0; i < outsz; ++i)
+                magbuf[i] *= pow_coefficient;
+        }
+        else
+        {
+            for(size_t i = 0; i < outsz; ++i)
+                magbuf[i] = std::sqrt(magbuf[i]) * coefficient;
+        }
+    }
+    clock.end();
+}
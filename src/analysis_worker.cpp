@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "analysis_worker.hpp"
+#include "source.hpp"
+#include <util/profiler.h>
+#include <algorithm>
+
+// profiler root of the worker thread, the stage scopes of the analyzed sources nest under it
+static const char *profiler_root = MODULE_NAME ": analysis worker";
+
+AnalysisWorker::~AnalysisWorker()
+{
+    shutdown();
+}
+
+AnalysisWorker& AnalysisWorker::get()
+{
+    static AnalysisWorker worker;
+    return worker;
+}
+
+void AnalysisWorker::enqueue(WAVSource *source, float seconds)
+{
+    {
+        std::lock_guard lock(m_mtx);
+        if(m_stop)
+            return;
+        auto it = std::find_if(m_queue.begin(), m_queue.end(), [source](const auto& i) { return i.first == source; });
+        if(it != m_queue.end())
+        {
+            it->second += seconds;
+            return;
+        }
+        m_queue.emplace_back(source, seconds);
+        if(!m_thread.joinable())
+            m_thread = std::thread(&AnalysisWorker::run, this);
+    }
+    m_work_cv.notify_one();
+}
+
+void AnalysisWorker::remove(WAVSource *source)
+{
+    std::unique_lock lock(m_mtx);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [source](const auto& i) { return i.first == source; }), m_queue.end());
+    m_idle_cv.wait(lock, [this, source] { return m_current != source; });
+}
+
+void AnalysisWorker::shutdown()
+{
+    {
+        std::lock_guard lock(m_mtx);
+        m_stop = true;
+        m_queue.clear();
+    }
+    m_work_cv.notify_all();
+    if(m_thread.joinable())
+        m_thread.join();
+}
+
+void AnalysisWorker::run()
+{
+    profile_register_root(profiler_root, 0);
+    std::unique_lock lock(m_mtx);
+    while(true)
+    {
+        m_work_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if(m_stop)
+            break;
+
+        auto [source, seconds] = m_queue.front();
+        m_queue.pop_front();
+        m_current = source;
+        lock.unlock();
+
+        // remove() blocks while m_current refers to the source, so it can't be destroyed under us
+        profile_start(profiler_root);
+        source->analyze_async(seconds);
+        profile_end(profiler_root);
+
+        lock.lock();
+        m_current = nullptr;
+        m_idle_cv.notify_all();
+    }
+}
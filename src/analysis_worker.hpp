@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <utility>
+
+class WAVSource;
+
+// plugin wide worker thread that runs audio analysis for sources with the analysis thread option enabled
+// keeps the FFT off the video thread, results are handed to the renderer through each source's triple buffer
+class AnalysisWorker
+{
+    std::mutex m_mtx;
+    std::condition_variable m_work_cv;  // signaled when work is queued or on shutdown
+    std::condition_variable m_idle_cv;  // signaled when a job finishes
+    std::thread m_thread;
+    std::deque<std::pair<WAVSource*, float>> m_queue; // pending sources and accumulated tick time
+    WAVSource *m_current = nullptr;                     // source being analyzed right now
+    bool m_stop = false;
+
+    void run();
+
+public:
+    AnalysisWorker() = default;
+    ~AnalysisWorker();
+
+    // no copying
+    AnalysisWorker(const AnalysisWorker&) = delete;
+    AnalysisWorker& operator=(const AnalysisWorker&) = delete;
+
+    // queue a source for analysis, starting the thread if needed
+    // repeated calls before the job runs are merged and their tick times added together
+    void enqueue(WAVSource *source, float seconds);
+
+    // drop any pending job for the source and wait for a running one to finish
+    // the caller must not hold the source's analysis lock
+    void remove(WAVSource *source);
+
+    // stop and join the thread, pending jobs are discarded
+    void shutdown();
+
+    static AnalysisWorker& get();
+};
@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "config_builder.hpp"
+#include <algorithm>
+
+ConfigBuilder::~ConfigBuilder()
+{
+    shutdown();
+}
+
+ConfigBuilder& ConfigBuilder::get()
+{
+    static ConfigBuilder builder;
+    return builder;
+}
+
+void ConfigBuilder::enqueue(WAVSource *source, const SourceSettings& settings)
+{
+    {
+        std::lock_guard lock(m_mtx);
+        if(m_stop)
+            return;
+        auto it = std::find_if(m_queue.begin(), m_queue.end(), [source](const auto& i) { return i.first == source; });
+        if(it != m_queue.end())
+        {
+            it->second = settings;
+            return;
+        }
+        m_queue.emplace_back(source, settings);
+        if(!m_thread.joinable())
+            m_thread = std::thread(&ConfigBuilder::run, this);
+    }
+    m_work_cv.notify_one();
+}
+
+void ConfigBuilder::retire(std::shared_ptr<AnalysisEngine> engine)
+{
+    if(engine == nullptr)
+        return;
+    {
+        std::lock_guard lock(m_mtx);
+        if(m_stop)
+            return; // released here after all
+        m_retired.push_back(std::move(engine));
+        if(!m_thread.joinable())
+            m_thread = std::thread(&ConfigBuilder::run, this);
+    }
+    m_work_cv.notify_one();
+}
+
+void ConfigBuilder::remove(WAVSource *source)
+{
+    std::unique_lock lock(m_mtx);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [source](const auto& i) { return i.first == source; }), m_queue.end());
+    m_idle_cv.wait(lock, [this, source] { return m_current != source; });
+}
+
+void ConfigBuilder::shutdown()
+{
+    std::vector<std::shared_ptr<AnalysisEngine>> retired;
+    {
+        std::lock_guard lock(m_mtx);
+        m_stop = true;
+        m_queue.clear();
+        std::swap(retired, m_retired);
+    }
+    m_work_cv.notify_all();
+    if(m_thread.joinable())
+        m_thread.join();
+}
+
+void ConfigBuilder::run()
+{
+    std::unique_lock lock(m_mtx);
+    while(true)
+    {
+        m_work_cv.wait(lock, [this] { return m_stop || !m_queue.empty() || !m_retired.empty(); });
+        if(m_stop)
+            break;
+
+        if(!m_retired.empty())
+        {
+            std::vector<std::shared_ptr<AnalysisEngine>> retired;
+            std::swap(retired, m_retired);
+            lock.unlock();
+            retired.clear();
+            lock.lock();
+            continue;
+        }
+
+        auto [source, settings] = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_current = source;
+        lock.unlock();
+
+        // remove() blocks while m_current refers to the source, so it can't be destroyed under us
+        source->build_async(settings);
+
+        lock.lock();
+        m_current = nullptr;
+        m_idle_cv.notify_all();
+    }
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "source.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// plugin wide thread that builds source configs after a settings change
+// engine setup, table generation and buffer allocation stay off the video thread
+// settings queued again before their build starts replace the queued ones, so slider drags only build the latest
+class ConfigBuilder
+{
+    std::mutex m_mtx;
+    std::condition_variable m_work_cv;  // signaled when work is queued or on shutdown
+    std::condition_variable m_idle_cv;  // signaled when a build finishes
+    std::thread m_thread;
+    std::deque<std::pair<WAVSource*, SourceSettings>> m_queue;  // pending sources and their newest settings
+    WAVSource *m_current = nullptr;                             // source being built right now
+    std::vector<std::shared_ptr<AnalysisEngine>> m_retired;     // engines replaced by a config, released by the thread
+    bool m_stop = false;
+
+    void run();
+
+public:
+    ConfigBuilder() = default;
+    ~ConfigBuilder();
+
+    // no copying
+    ConfigBuilder(const ConfigBuilder&) = delete;
+    ConfigBuilder& operator=(const ConfigBuilder&) = delete;
+
+    // queue a build for the source, starting the thread if needed
+    void enqueue(WAVSource *source, const SourceSettings& settings);
+
+    // release a replaced engine on the builder thread, if it was the last reference its teardown stays off the video thread
+    void retire(std::shared_ptr<AnalysisEngine> engine);
+
+    // drop any pending build for the source and wait for a running one to finish
+    void remove(WAVSource *source);
+
+    // stop and join the thread, pending builds are discarded
+    void shutdown();
+
+    static ConfigBuilder& get();
+};
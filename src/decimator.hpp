@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "aligned_mem.hpp"
+#include "ring_buffer.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <immintrin.h>
+
+// low-pass filter and keep every factor'th sample, on the way into a RingBuffer
+// windowed sinc FIR with its cutoff at the new nyquist frequency
+// below PASSBAND of the new nyquist it is flat to well under 0.01 dB, the transition band above that only aliases
+// back down onto frequencies above PASSBAND, and everything further up is attenuated by more than 75 dB
+// all memory is allocated by reset(), so push() is safe on the audio thread
+class Decimator
+{
+    static constexpr size_t TAPS_PER_FACTOR = 32;
+    static constexpr size_t BLOCK = 256;    // input samples filtered per pass
+
+    size_t m_factor = 1;
+    size_t m_taps = 0;              // multiple of 4
+    std::unique_ptr<float[], AVXDeleter> m_coefficients;
+    std::unique_ptr<float[], AVXDeleter> m_input;   // unconsumed input, the next output starts at m_input[0]
+    std::unique_ptr<float[], AVXDeleter> m_output;
+    size_t m_fill = 0;
+
+    float dot(const float *samples) const
+    {
+        auto sum = _mm_setzero_ps();
+        for(size_t i = 0; i < m_taps; i += 4)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&samples[i]), _mm_load_ps(&m_coefficients[i])));
+        alignas(16) float sums[4];
+        _mm_store_ps(sums, sum);
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+public:
+    static constexpr float PASSBAND = 0.8f; // fraction of the new nyquist frequency that is displayed unaltered
+
+    Decimator() = default;
+
+    // no copying
+    Decimator(const Decimator&) = delete;
+    Decimator& operator=(const Decimator&) = delete;
+
+    // (re)build the filter for factor (1 disables it) and start from silence
+    // NOT thread safe
+    void reset(size_t factor)
+    {
+        m_factor = factor;
+        m_fill = 0;
+        if(factor <= 1)
+        {
+            m_taps = 0;
+            m_coefficients.reset();
+            m_input.reset();
+            m_output.reset();
+            return;
+        }
+
+        // blackman windowed sinc, normalized for unity gain at DC
+        m_taps = TAPS_PER_FACTOR * factor;
+        m_coefficients.reset(avx_alloc<float>(m_taps));
+        const auto center = (double)(m_taps - 1) / 2.0;
+        double total = 0.0;
+        for(size_t i = 0; i < m_taps; ++i)
+        {
+            const auto x = ((double)i - center) / (double)factor;
+            const auto sinc = std::sin(M_PI * x) / (M_PI * x);
+            const auto w = (2.0 * M_PI * (double)i) / (double)(m_taps - 1);
+            const auto blackman = 0.42 - (0.5 * std::cos(w)) + (0.08 * std::cos(2.0 * w));
+            m_coefficients[i] = (float)(sinc * blackman);
+            total += m_coefficients[i];
+        }
+        for(size_t i = 0; i < m_taps; ++i)
+            m_coefficients[i] = (float)(m_coefficients[i] / total);
+
+        m_input.reset(avx_alloc<float>(m_taps + BLOCK));
+        m_output.reset(avx_alloc<float>(BLOCK));
+        memset(m_input.get(), 0, m_taps * sizeof(float));
+        m_fill = m_taps - factor;   // primed with silence, the first output is due after factor samples
+    }
+
+    size_t factor() const { return m_factor; }
+
+    // filter count input samples (or zeroes if data is null) and push the decimated result into out
+    void push(const float *data, size_t count, RingBuffer& out)
+    {
+        if(m_factor <= 1)
+        {
+            out.push_back(data, count);
+            return;
+        }
+
+        while(count > 0)
+        {
+            const auto n = std::min(count, BLOCK);
+            if(data != nullptr)
+            {
+                memcpy(&m_input[m_fill], data, n * sizeof(float));
+                data += n;
+            }
+            else
+                memset(&m_input[m_fill], 0, n * sizeof(float));
+            m_fill += n;
+            count -= n;
+
+            size_t start = 0;
+            size_t produced = 0;
+            for(; start + m_taps <= m_fill; start += m_factor)
+                m_output[produced++] = dot(&m_input[start]);
+            out.push_back(m_output.get(), produced);
+
+            m_fill -= start;
+            memmove(m_input.get(), &m_input[start], m_fill * sizeof(float));
+        }
+    }
+};
@@ -0,0 +1,203 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "fft_planner.hpp"
+#include "analysis_engine.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <cstdio>
+#include <cstdlib>
+
+FFTPlanner::~FFTPlanner()
+{
+    shutdown();
+}
+
+FFTPlanner& FFTPlanner::get()
+{
+    static FFTPlanner planner;
+    return planner;
+}
+
+void FFTPlanner::load_wisdom()
+{
+    auto path = obs_module_config_path("fftw_wisdom");
+    if(path == nullptr)
+        return;
+    {
+        std::lock_guard lock(m_planner_mtx);
+        if(os_file_exists(path) && !fftwf_import_wisdom_from_filename(path))
+            blog(LOG_WARNING, "[" MODULE_NAME "]: Failed to load FFTW wisdom from \"%s\"", path);
+    }
+    bfree(path);
+}
+
+// wisdom is exported under m_planner_mtx, the file is written without it
+void FFTPlanner::save_wisdom(const char *wisdom)
+{
+    auto dir = obs_module_config_path("");
+    auto path = obs_module_config_path("fftw_wisdom");
+    if((dir != nullptr) && (path != nullptr))
+    {
+        os_mkdirs(dir);
+        auto file = std::fopen(path, "w");
+        auto ok = (file != nullptr) && (std::fputs(wisdom, file) >= 0);
+        if((file != nullptr) && (std::fclose(file) != 0))
+            ok = false;
+        if(!ok)
+            blog(LOG_WARNING, "[" MODULE_NAME "]: Failed to save FFTW wisdom to \"%s\"", path);
+    }
+    bfree(dir);
+    bfree(path);
+}
+
+fftwf_plan FFTPlanner::plan_r2c(size_t size, float *input, fftwf_complex *output, bool& measured)
+{
+    measured = false;
+    std::unique_lock planner_lock(m_planner_mtx, std::defer_lock);
+    while(!planner_lock.try_lock())
+    {
+        // other planner calls are short, a measurement is not
+        {
+            std::lock_guard lock(m_mtx);
+            if(m_measuring)
+                return nullptr;
+        }
+        std::this_thread::yield();
+    }
+
+    // wisdom only planning never measures, so the buffers are left alone
+    auto plan = fftwf_plan_dft_r2c_1d((int)size, input, output, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+    measured = plan != nullptr;
+    if(!measured)
+        plan = fftwf_plan_dft_r2c_1d((int)size, input, output, FFTW_ESTIMATE);
+    return plan;
+}
+
+void FFTPlanner::destroy_plan(fftwf_plan plan)
+{
+    if(plan == nullptr)
+        return;
+    std::unique_lock planner_lock(m_planner_mtx, std::defer_lock);
+    while(!planner_lock.try_lock())
+    {
+        {
+            std::lock_guard lock(m_mtx);
+            if(m_measuring)
+            {
+                m_retired.push_back(plan);
+                return;
+            }
+        }
+        std::this_thread::yield();
+    }
+    fftwf_destroy_plan(plan);
+}
+
+void FFTPlanner::request_measured(size_t size, std::weak_ptr<AnalysisEngine> engine)
+{
+    {
+        std::lock_guard lock(m_mtx);
+        if(m_stop)
+            return;
+        m_queue.emplace_back(size, std::move(engine));
+        if(!m_thread.joinable())
+            m_thread = std::thread(&FFTPlanner::run, this);
+    }
+    m_cv.notify_one();
+}
+
+void FFTPlanner::shutdown()
+{
+    {
+        std::lock_guard lock(m_mtx);
+        m_stop = true;
+        m_queue.clear();
+    }
+    m_cv.notify_all();
+    if(m_thread.joinable())
+        m_thread.join();
+}
+
+void FFTPlanner::run()
+{
+    std::unique_lock lock(m_mtx);
+    while(true)
+    {
+        m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if(m_stop)
+            break;
+
+        auto [size, weak_engine] = m_queue.front();
+        m_queue.pop_front();
+        lock.unlock();
+
+        // FFTW_MEASURE overwrites the buffers, so plan on scratch buffers with the same alignment
+        AVXBufR input(avx_alloc<float>(size));
+        AVXBufC output(avx_alloc<fftwf_complex>(size));
+
+        // engines created during an earlier measurement have no plan yet, the quick one tides them over
+        auto engine = weak_engine.lock();
+        auto measured = false;
+        if((engine != nullptr) && !engine->has_plan())
+        {
+            auto plan = plan_r2c(size, input.get(), output.get(), measured);
+            destroy_plan(engine->swap_plan(plan, measured));
+        }
+
+        // engines that went away while queued, or got a plan from wisdom, don't need a measurement
+        const auto measure = (engine != nullptr) && !measured;
+        engine.reset();
+        if(measure && !weak_engine.expired())
+        {
+            {
+                std::lock_guard state_lock(m_mtx);
+                m_measuring = true;
+            }
+            fftwf_plan plan;
+            char *wisdom = nullptr;
+            {
+                std::lock_guard planner_lock(m_planner_mtx);
+                plan = fftwf_plan_dft_r2c_1d((int)size, input.get(), output.get(), FFTW_MEASURE);
+                if(plan != nullptr)
+                    wisdom = fftwf_export_wisdom_to_string();
+            }
+            std::vector<fftwf_plan> retired;
+            {
+                std::lock_guard state_lock(m_mtx);
+                m_measuring = false;
+                std::swap(retired, m_retired);
+            }
+            for(auto i : retired)
+                destroy_plan(i);
+            if(wisdom != nullptr)
+            {
+                save_wisdom(wisdom);
+                std::free(wisdom);
+            }
+
+            engine = weak_engine.lock();
+            if(engine != nullptr)
+                plan = engine->swap_plan(plan, true);
+            destroy_plan(plan);
+        }
+
+        // the last reference may go here, and the engine destroys its plan through m_mtx
+        engine.reset();
+        lock.lock();
+    }
+}
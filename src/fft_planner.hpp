@@ -0,0 +1,77 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <fftw3.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class AnalysisEngine;
+
+// owns every call into the FFTW planner, which is not thread safe
+// engines start out with an estimated plan and get a measured one swapped in once the background thread has it
+// measured plans are saved as wisdom in the plugin config directory so they only have to be measured once
+// a measurement holds the planner for as long as it takes, so other threads never wait for one
+class FFTPlanner
+{
+    std::mutex m_planner_mtx;           // serializes planner calls (plan creation/destruction and wisdom)
+    std::mutex m_mtx;                   // guards the job queue and everything below it
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    std::deque<std::pair<size_t, std::weak_ptr<AnalysisEngine>>> m_queue;  // FFT size and the engine waiting for it
+    bool m_stop = false;
+    bool m_measuring = false;           // the thread is measuring with m_planner_mtx held
+    std::vector<fftwf_plan> m_retired;  // plans destroyed during a measurement, freed by the thread once it's done
+
+    void run();
+    void save_wisdom(const char *wisdom);
+
+public:
+    FFTPlanner() = default;
+    ~FFTPlanner();
+
+    // no copying
+    FFTPlanner(const FFTPlanner&) = delete;
+    FFTPlanner& operator=(const FFTPlanner&) = delete;
+
+    // import saved wisdom, call once at module load
+    void load_wisdom();
+
+    // create a real to complex plan for the given buffers
+    // uses measured wisdom if there is any, otherwise falls back to FFTW_ESTIMATE and sets measured to false
+    // returns nullptr during a measurement instead of waiting for it, request_measured() then supplies the plan
+    // plans are executed with fftwf_execute_dft_r2c(), so any buffers with the same alignment can be used
+    fftwf_plan plan_r2c(size_t size, float *input, fftwf_complex *output, bool& measured);
+
+    // during a measurement the plan is handed to the thread instead of waiting for it
+    void destroy_plan(fftwf_plan plan);
+
+    // measure a plan for size in the background and hand it to the engine with AnalysisEngine::swap_plan()
+    // an engine without any plan gets the plan_r2c() one first
+    void request_measured(size_t size, std::weak_ptr<AnalysisEngine> engine);
+
+    // stop and join the thread, pending jobs are discarded
+    void shutdown();
+
+    static FFTPlanner& get();
+};
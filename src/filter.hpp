@@ -162,24 +162,20 @@ T weighted_avg_fma3(const std::vector<T>& samples, const Kernel<T>& kernel, intm
     }
 }
 
+// filtered must be the same size as samples
 template<typename T>
-std::vector<T> apply_filter(const std::vector<T>& samples, const Kernel<T>& kernel)
+void apply_filter(const std::vector<T>& samples, const Kernel<T>& kernel, std::vector<T>& filtered)
 {
     auto sz = samples.size();
-    std::vector<T> filtered;
-    filtered.resize(sz);
     for(auto i = 0u; i < sz; ++i)
         filtered[i] = weighted_avg(samples, kernel, i);
-    return filtered;
 }
 
 template<typename T>
 DECORATE_AVX
-std::vector<T> apply_filter_fma3(const std::vector<T>& samples, const Kernel<T>& kernel)
+void apply_filter_fma3(const std::vector<T>& samples, const Kernel<T>& kernel, std::vector<T>& filtered)
 {
     auto sz = samples.size();
-    std::vector<T> filtered;
-    filtered.resize(sz);
     if((size_t)kernel.sse_size >= ((sizeof(__m128) / sizeof(T)) * 2)) // make sure we get at least 2 SIMD iterations
     {
         for(auto i = 0u; i < sz; ++i)
@@ -190,5 +186,88 @@ std::vector<T> apply_filter_fma3(const std::vector<T>& samples, const Kernel<T>&
         for(auto i = 0u; i < sz; ++i)
             filtered[i] = weighted_avg(samples, kernel, i);
     }
-    return filtered;
+}
+
+// recursive gaussian (Young & van Vliet, 1995)
+// a causal and an anti-causal 3rd order IIR pass, cost is independent of sigma
+// the coefficients only fit the gaussian well from RECURSIVE_GAUSS_MIN_SIGMA up, use the (small) direct kernel below that
+// the signal is treated as zero outside the buffer and each output is divided by the filter's response to
+// an all ones buffer, the same renormalization weighted_avg() does at the edges
+constexpr float RECURSIVE_GAUSS_MIN_SIGMA = 2.0f;
+
+template<typename T>
+struct RecursiveGauss
+{
+    T b = (T)0;         // B
+    T a1 = (T)0;        // b1 / b0
+    T a2 = (T)0;        // b2 / b0
+    T a3 = (T)0;        // b3 / b0
+    std::vector<T> norm;    // 1 / response to all ones, per sample
+    size_t tail = 0;        // length of the causal response past the end of the buffer, feeds the anti-causal pass
+};
+
+template<typename T>
+void recursive_gauss_pass(T *samples, size_t size, const RecursiveGauss<T>& filter, T *tail)
+{
+    // causal, zero state before the first sample
+    T w1 = (T)0, w2 = (T)0, w3 = (T)0;
+    auto step = [&](T x) {
+        const auto w = (filter.b * x) + (filter.a1 * w1) + (filter.a2 * w2) + (filter.a3 * w3);
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+        return w;
+    };
+    for(size_t i = 0; i < size; ++i)
+        samples[i] = step(samples[i]);
+
+    // the causal output keeps ringing past the end, which the anti-causal pass needs to see
+    for(size_t i = 0; i < filter.tail; ++i)
+        tail[i] = step((T)0);
+
+    // anti-causal
+    w1 = w2 = w3 = (T)0;
+    for(size_t i = filter.tail; i-- > 0;)
+        step(tail[i]);
+    for(size_t i = size; i-- > 0;)
+        samples[i] = step(samples[i]);
+}
+
+template<typename T>
+RecursiveGauss<T> make_recursive_gauss(T sigma, size_t size)
+{
+    RecursiveGauss<T> ret;
+    sigma = std::max(std::abs(sigma), (T)RECURSIVE_GAUSS_MIN_SIGMA);
+    const auto q = (sigma >= (T)2.5) ? (((T)0.98711 * sigma) - (T)0.96330) : ((T)3.97156 - ((T)4.14554 * std::sqrt((T)1 - ((T)0.26891 * sigma))));
+    const auto q2 = q * q;
+    const auto q3 = q2 * q;
+    const auto b0 = (T)1.57825 + ((T)2.44413 * q) + ((T)1.4281 * q2) + ((T)0.422205 * q3);
+    const auto b1 = ((T)2.44413 * q) + ((T)2.85619 * q2) + ((T)1.26661 * q3);
+    const auto b2 = -(((T)1.4281 * q2) + ((T)1.26661 * q3));
+    const auto b3 = (T)0.422205 * q3;
+    ret.a1 = b1 / b0;
+    ret.a2 = b2 / b0;
+    ret.a3 = b3 / b0;
+    ret.b = (T)1 - (ret.a1 + ret.a2 + ret.a3);
+    ret.tail = (size_t)std::ceil((T)4 * sigma) + 3;
+
+    std::vector<T> tail(ret.tail);
+    ret.norm.assign(size, (T)1);
+    recursive_gauss_pass(ret.norm.data(), size, ret, tail.data());
+    for(auto& i : ret.norm)
+        i = (T)1 / i;
+    return ret;
+}
+
+// in place, samples must be the size the filter was made for
+// the filter is read only so it can be shared, scratch holds the tail and is resized as needed
+template<typename T>
+void apply_recursive_gauss(std::vector<T>& samples, const RecursiveGauss<T>& filter, std::vector<T>& scratch)
+{
+    const auto sz = samples.size();
+    if(scratch.size() < filter.tail)
+        scratch.resize(filter.tail);
+    recursive_gauss_pass(samples.data(), sz, filter, scratch.data());
+    for(size_t i = 0; i < sz; ++i)
+        samples[i] *= filter.norm[i];
 }
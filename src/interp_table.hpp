@@ -0,0 +1,219 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "waveform_config.hpp"
+#include "aligned_mem.hpp"
+#include "math_funcs.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <immintrin.h>
+
+// precomputed lanczos weights for a fixed set of sample positions
+// each output reads TAPS consecutive bins from starts[i], weights are stored tap-major so that
+// 8 outputs can be computed at once with one gather and one FMA per tap
+// outputs are padded to a multiple of 8 with zero weights
+struct InterpTable
+{
+    static constexpr int TAPS = 8;  // enough for lanczos windows up to 4
+
+    std::unique_ptr<int32_t[], AVXDeleter> starts;
+    std::unique_ptr<float[], AVXDeleter> weights;   // weights[(tap * padded) + i]
+    size_t count = 0;
+    size_t padded = 0;
+};
+
+// positions must be in [0, len - 1] and len must be at least TAPS
+static inline InterpTable make_lanczos_table(const float *positions, size_t count, size_t len, float w)
+{
+    InterpTable ret;
+    ret.count = count;
+    ret.padded = (count + 7) & ~(size_t)7;
+    ret.starts.reset(avx_alloc<int32_t>(ret.padded));
+    ret.weights.reset(avx_alloc<float>(ret.padded * InterpTable::TAPS));
+    for(size_t i = 0; i < ret.padded; ++i)
+    {
+        if(i >= count)
+        {
+            ret.starts[i] = 0;
+            for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+                ret.weights[(tap * ret.padded) + i] = 0.0f;
+            continue;
+        }
+
+        // window of TAPS bins around the position, kept inside the buffer
+        // bins outside the lanczos support get a weight of 0, so this matches lanczos_interp()
+        const auto x = positions[i];
+        const auto start = std::clamp((intmax_t)x - (intmax_t)w + 1, (intmax_t)0, (intmax_t)len - InterpTable::TAPS);
+        ret.starts[i] = (int32_t)start;
+        for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+            ret.weights[(tap * ret.padded) + i] = lanczos(x - (float)(start + tap), w);
+    }
+    return ret;
+}
+
+static inline void apply_interp(const InterpTable& table, const float *src, float *dst)
+{
+    for(size_t i = 0; i < table.count; ++i)
+    {
+        const auto s = &src[table.starts[i]];
+        float sum = 0.0f;
+        for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+            sum += s[tap] * table.weights[(tap * table.padded) + i];
+        dst[i] = sum;
+    }
+}
+
+DECORATE_AVX2
+static inline void apply_interp_avx2(const InterpTable& table, const float *src, float *dst)
+{
+    size_t i = 0;
+    for(; i + 8 <= table.count; i += 8)
+    {
+        const auto idx = _mm256_load_si256((const __m256i*)&table.starts[i]);
+        auto sum = _mm256_setzero_ps();
+        for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+        {
+            const auto vals = _mm256_i32gather_ps(&src[tap], idx, sizeof(float));
+            sum = _mm256_fmadd_ps(vals, _mm256_load_ps(&table.weights[(tap * table.padded) + i]), sum);
+        }
+        _mm256_storeu_ps(&dst[i], sum);
+    }
+
+    // tail
+    for(; i < table.count; ++i)
+    {
+        const auto s = &src[table.starts[i]];
+        float sum = 0.0f;
+        for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+            sum += s[tap] * table.weights[(tap * table.padded) + i];
+        dst[i] = sum;
+    }
+}
+
+// sparse bins -> bars matrix in CSR form, for bar displays
+// a row's nonzero columns are always one run of consecutive bins, so only its first column is stored
+// and the weights of a row can be applied with plain vector loads
+struct BandMatrix
+{
+    std::vector<uint32_t> offsets;  // weights of row i are weights[offsets[i]] to weights[offsets[i + 1] - 1]
+    std::vector<uint32_t> columns;  // bin of the first weight of each row
+    std::vector<float> weights;
+
+    size_t rows() const { return columns.size(); }
+};
+
+// merge the rows of table from groups[i] up to groups[i + 1] into row i, adding up the weights of each bin
+// with average set each row is divided by the number of table rows in it
+static inline BandMatrix make_band_matrix(const InterpTable& table, const std::vector<uint32_t>& groups, bool average)
+{
+    BandMatrix ret;
+    const auto rows = groups.size() - 1;
+    ret.offsets.reserve(rows + 1);
+    ret.columns.reserve(rows);
+    std::vector<float> row;
+    for(size_t i = 0; i < rows; ++i)
+    {
+        // consecutive positions have consecutive windows, so the row spans from the first start to the last
+        const auto first = groups[i];
+        const auto last = groups[i + 1];
+        const auto begin = (size_t)table.starts[first];
+        row.assign((size_t)table.starts[last - 1] + InterpTable::TAPS - begin, 0.0f);
+        const auto scale = average ? 1.0f / (float)(last - first) : 1.0f;
+        for(auto j = first; j < last; ++j)
+            for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+                row[table.starts[j] + tap - begin] += table.weights[(tap * table.padded) + j] * scale;
+
+        // the lanczos window is narrower than TAPS, so trim the zeroes at either end
+        size_t lo = 0;
+        auto hi = row.size();
+        while((lo + 1 < hi) && (row[lo] == 0.0f))
+            ++lo;
+        while((hi - 1 > lo) && (row[hi - 1] == 0.0f))
+            --hi;
+        ret.offsets.push_back((uint32_t)ret.weights.size());
+        ret.columns.push_back((uint32_t)(begin + lo));
+        ret.weights.insert(ret.weights.end(), row.begin() + lo, row.begin() + hi);
+    }
+    ret.offsets.push_back((uint32_t)ret.weights.size());
+    return ret;
+}
+
+// row i covers the bins from indices[i] up to indices[i + 1] (at least one), all weighted equally
+static inline BandMatrix make_band_matrix(const float *indices, size_t rows, bool average)
+{
+    BandMatrix ret;
+    ret.offsets.reserve(rows + 1);
+    ret.columns.reserve(rows);
+    for(size_t i = 0; i < rows; ++i)
+    {
+        const auto begin = (size_t)indices[i];
+        const auto count = std::max((size_t)indices[i + 1], begin + 1) - begin;
+        ret.offsets.push_back((uint32_t)ret.weights.size());
+        ret.columns.push_back((uint32_t)begin);
+        ret.weights.insert(ret.weights.end(), count, average ? 1.0f / (float)count : 1.0f);
+    }
+    ret.offsets.push_back((uint32_t)ret.weights.size());
+    return ret;
+}
+
+// dst = matrix * src, or matrix * src^2 with SQUARED
+template<bool SQUARED>
+static inline void apply_band_matrix(const BandMatrix& matrix, const float *src, float *dst)
+{
+    for(size_t i = 0; i < matrix.rows(); ++i)
+    {
+        const auto s = &src[matrix.columns[i]];
+        const auto w = &matrix.weights[matrix.offsets[i]];
+        const auto count = matrix.offsets[i + 1] - matrix.offsets[i];
+        float sum = 0.0f;
+        for(size_t j = 0; j < count; ++j)
+            sum += (SQUARED ? s[j] * s[j] : s[j]) * w[j];
+        dst[i] = sum;
+    }
+}
+
+template<bool SQUARED>
+DECORATE_AVX2
+static inline void apply_band_matrix_avx2(const BandMatrix& matrix, const float *src, float *dst)
+{
+    for(size_t i = 0; i < matrix.rows(); ++i)
+    {
+        const auto s = &src[matrix.columns[i]];
+        const auto w = &matrix.weights[matrix.offsets[i]];
+        const auto count = matrix.offsets[i + 1] - matrix.offsets[i];
+        auto vsum = _mm256_setzero_ps();
+        size_t j = 0;
+        for(; j + 8 <= count; j += 8)
+        {
+            auto vals = _mm256_loadu_ps(&s[j]);
+            if constexpr(SQUARED)
+                vals = _mm256_mul_ps(vals, vals);
+            vsum = _mm256_fmadd_ps(vals, _mm256_loadu_ps(&w[j]), vsum);
+        }
+        auto half = _mm_add_ps(_mm256_castps256_ps128(vsum), _mm256_extractf128_ps(vsum, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        auto sum = _mm_cvtss_f32(_mm_add_ss(half, _mm_movehdup_ps(half)));
+
+        // tail
+        for(; j < count; ++j)
+            sum += (SQUARED ? s[j] * s[j] : s[j]) * w[j];
+        dst[i] = sum;
+    }
+}
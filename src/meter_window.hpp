@@ -0,0 +1,194 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "aligned_mem.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <immintrin.h>
+
+// sliding window of audio samples for the level meter
+// the circular buffer is split into 16 sample blocks, complete blocks keep their sum of squares and peak
+// a running sum and a monotonic queue of block peaks make RMS and peak reads constant time
+// so the per frame cost depends on the number of new samples rather than the window length
+class MeterWindow
+{
+    static constexpr size_t BLOCK = 16; // window sizes are multiples of 16
+
+    std::unique_ptr<float[], AVXDeleter> m_samples; // circular buffer of the last m_size samples
+    size_t m_size = 0;
+    size_t m_blocks = 0;
+    size_t m_pos = 0;               // write position, the block it is in is scanned on every read
+
+    // sum of squares of every block except the one being written
+    // doubles keep the drift tiny and it is recomputed once per window length anyway
+    std::unique_ptr<float[], AVXDeleter> m_block_sum;
+    double m_sum = 0.0;
+    size_t m_since_rescan = 0;
+
+    // block peaks in decreasing order with their block numbers, oldest first
+    // blocks not in the queue are dominated by a newer one
+    std::unique_ptr<float[], AVXDeleter> m_peak_vals;
+    std::unique_ptr<uint32_t[], AVXDeleter> m_peak_ids;
+    size_t m_peak_head = 0;
+    size_t m_peak_len = 0;
+
+    // sum of squares and largest magnitude of one block
+    static void block_stats(const float *samples, float& sum, float& peak)
+    {
+        const auto signbit = _mm_set1_ps(-0.0f);
+        auto sumvec = _mm_setzero_ps();
+        auto maxvec = _mm_setzero_ps();
+        for(size_t i = 0; i < BLOCK; i += 4)
+        {
+            auto chunk = _mm_load_ps(&samples[i]);
+            sumvec = _mm_add_ps(sumvec, _mm_mul_ps(chunk, chunk));
+            maxvec = _mm_max_ps(maxvec, _mm_andnot_ps(signbit, chunk));
+        }
+        alignas(16) float sums[4], maxes[4];
+        _mm_store_ps(sums, sumvec);
+        _mm_store_ps(maxes, maxvec);
+        sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+        peak = std::max(std::max(maxes[0], maxes[1]), std::max(maxes[2], maxes[3]));
+    }
+
+    size_t peak_slot(size_t i) const
+    {
+        i += m_peak_head;
+        return (i >= m_blocks) ? i - m_blocks : i;
+    }
+
+    // block was just completed and the write position moved on to the next one
+    void finish_block(size_t block)
+    {
+        float sum, peak;
+        block_stats(&m_samples[block * BLOCK], sum, peak);
+        const auto next = (block + 1 < m_blocks) ? block + 1 : 0;
+
+        m_block_sum[block] = sum;
+        m_sum += sum;
+        m_sum -= m_block_sum[next];
+
+        // anything at or below the new block can never be the peak again
+        while((m_peak_len > 0) && (m_peak_vals[peak_slot(m_peak_len - 1)] <= peak))
+            --m_peak_len;
+        const auto back = peak_slot(m_peak_len);
+        m_peak_vals[back] = peak;
+        m_peak_ids[back] = (uint32_t)block;
+        ++m_peak_len;
+
+        // the next block is being overwritten now, it is scanned directly until complete
+        if(m_peak_ids[m_peak_head] == next)
+        {
+            m_peak_head = peak_slot(1);
+            --m_peak_len;
+        }
+
+        // bound the drift of the running sum
+        if(++m_since_rescan >= m_blocks)
+        {
+            double total = 0.0;
+            for(size_t i = 0; i < m_blocks; ++i)
+                if(i != next)
+                    total += m_block_sum[i];
+            m_sum = total;
+            m_since_rescan = 0;
+        }
+    }
+
+public:
+    MeterWindow() = default;
+
+    // no copying
+    MeterWindow(const MeterWindow&) = delete;
+    MeterWindow& operator=(const MeterWindow&) = delete;
+
+    MeterWindow(MeterWindow&&) = default;
+    MeterWindow& operator=(MeterWindow&&) = default;
+
+    // (re)allocate for a window of size samples (multiple of 16), all zero
+    void reset(size_t size)
+    {
+        if(size != m_size)
+        {
+            m_size = size;
+            m_blocks = size / BLOCK;
+            m_samples.reset(avx_alloc<float>(m_size));
+            m_block_sum.reset(avx_alloc<float>(m_blocks));
+            m_peak_vals.reset(avx_alloc<float>(m_blocks));
+            m_peak_ids.reset(avx_alloc<uint32_t>(m_blocks));
+        }
+        memset(m_samples.get(), 0, m_size * sizeof(float));
+        memset(m_block_sum.get(), 0, m_blocks * sizeof(float));
+        m_pos = 0;
+        m_sum = 0.0;
+        m_since_rescan = 0;
+        m_peak_head = 0;
+        m_peak_len = 0;
+    }
+
+    void release()
+    {
+        m_samples.reset();
+        m_block_sum.reset();
+        m_peak_vals.reset();
+        m_peak_ids.reset();
+        m_size = 0;
+        m_blocks = 0;
+        m_pos = 0;
+        m_peak_len = 0;
+    }
+
+    size_t size() const { return m_size; }
+
+    // number of samples that can be written contiguously at the write position
+    size_t contiguous() const { return m_size - m_pos; }
+
+    // where new samples go, write up to contiguous() samples then commit() them
+    float *write_ptr() { return &m_samples[m_pos]; }
+
+    void commit(size_t count)
+    {
+        const auto end = m_pos + count;
+        for(auto block = m_pos / BLOCK; block < end / BLOCK; ++block)
+            finish_block(block);
+        m_pos = (end >= m_size) ? 0 : end;
+    }
+
+    // mean of the squared samples in the window
+    float mean_square() const
+    {
+        if(m_size == 0)
+            return 0.0f;
+        float sum, peak;
+        block_stats(&m_samples[m_pos & -BLOCK], sum, peak);
+        return (float)(std::max(m_sum + sum, 0.0) / m_size);
+    }
+
+    // largest magnitude in the window
+    float peak() const
+    {
+        if(m_size == 0)
+            return 0.0f;
+        float sum, peak;
+        block_stats(&m_samples[m_pos & -BLOCK], sum, peak);
+        return (m_peak_len > 0) ? std::max(m_peak_vals[m_peak_head], peak) : peak;
+    }
+};
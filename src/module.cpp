@@ -17,6 +17,9 @@
 
 #include "module.hpp"
 #include "source.hpp"
+#include "analysis_worker.hpp"
+#include "config_builder.hpp"
+#include "fft_planner.hpp"
 #include <obs-module.h>
 
 OBS_DECLARE_MODULE()
@@ -34,11 +37,17 @@ MODULE_EXPORT const char *obs_module_description()
 
 MODULE_EXPORT bool obs_module_load()
 {
+    FFTPlanner::get().load_wisdom();
     WAVSource::register_source();
     return true;
 }
 
 MODULE_EXPORT void obs_module_unload()
 {
-    //...
+    ConfigBuilder::get().shutdown(); // may still be acquiring engines
+    FFTPlanner::get().shutdown();
+    AnalysisWorker::get().shutdown();
+    obs_enter_graphics();
+    WAVSource::free_effect();
+    obs_leave_graphics();
 }
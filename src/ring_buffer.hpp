@@ -0,0 +1,167 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "aligned_mem.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+// wait-free single-producer/single-consumer ring buffer of audio samples
+// the producer (audio thread) only ever advances m_write and the consumer (video thread) only ever advances m_read
+// neither side can block the other, if the consumer falls behind then new samples are dropped until space is freed
+// reset() is the only operation that is not thread safe, it must not be called while a producer is attached
+class RingBuffer
+{
+    std::unique_ptr<float[], AVXDeleter> m_buf;
+    size_t m_capacity = 0;  // always a power of 2
+    size_t m_mask = 0;
+
+    // monotonic sample counters, positions are (counter & m_mask)
+    // kept on separate cache lines to avoid false sharing between the producer and consumer
+    alignas(64) std::atomic_size_t m_write{ 0 };
+    alignas(64) std::atomic_size_t m_read{ 0 };
+
+    // copy count samples starting at pos out of the ring, handling wrap around
+    void copy_out(float *dst, size_t pos, size_t count) const
+    {
+        const auto start = pos & m_mask;
+        const auto first = std::min(count, m_capacity - start);
+        memcpy(dst, &m_buf[start], first * sizeof(float));
+        if(first < count)
+            memcpy(&dst[first], &m_buf[0], (count - first) * sizeof(float));
+    }
+
+    // copy count samples into the ring starting at pos (or zero them if src is null)
+    void copy_in(const float *src, size_t pos, size_t count)
+    {
+        const auto start = pos & m_mask;
+        const auto first = std::min(count, m_capacity - start);
+        if(src != nullptr)
+        {
+            memcpy(&m_buf[start], src, first * sizeof(float));
+            if(first < count)
+                memcpy(&m_buf[0], &src[first], (count - first) * sizeof(float));
+        }
+        else
+        {
+            memset(&m_buf[start], 0, first * sizeof(float));
+            if(first < count)
+                memset(&m_buf[0], 0, (count - first) * sizeof(float));
+        }
+    }
+
+public:
+    RingBuffer() = default;
+
+    // no copying
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // (re)allocate with room for at least min_capacity samples and discard all contents
+    // NOT thread safe
+    void reset(size_t min_capacity)
+    {
+        size_t capacity = 64;
+        while(capacity < min_capacity)
+            capacity <<= 1;
+        if(capacity != m_capacity)
+        {
+            m_buf.reset(avx_alloc<float>(capacity));
+            m_capacity = capacity;
+            m_mask = capacity - 1;
+        }
+        m_write.store(0, std::memory_order_relaxed);
+        m_read.store(0, std::memory_order_relaxed);
+    }
+
+    // free the backing memory
+    // NOT thread safe
+    void release()
+    {
+        m_buf.reset();
+        m_capacity = 0;
+        m_mask = 0;
+        m_write.store(0, std::memory_order_relaxed);
+        m_read.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // producer: append count samples, or count zeroes if data is null
+    // returns the number of samples actually written
+    size_t push_back(const float *data, size_t count)
+    {
+        if(m_capacity == 0)
+            return 0;
+        const auto write = m_write.load(std::memory_order_relaxed);
+        const auto read = m_read.load(std::memory_order_acquire);
+        count = std::min(count, m_capacity - (write - read));
+        copy_in(data, write, count);
+        m_write.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t push_back_zero(size_t count)
+    {
+        return push_back(nullptr, count);
+    }
+
+    // consumer: number of samples available for reading
+    size_t size() const
+    {
+        return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_relaxed);
+    }
+
+    // consumer: copy the oldest count samples without removing them
+    // caller must ensure size() >= count
+    void peek_front(float *dst, size_t count) const
+    {
+        copy_out(dst, m_read.load(std::memory_order_relaxed), count);
+    }
+
+    // consumer: point runs at the oldest count samples without copying or removing them
+    // returns the length of runs[0], runs[1] holds the rest if they wrap around
+    // for transforming samples on the way out instead of copying them first
+    // caller must ensure size() >= count
+    size_t peek_runs(size_t count, const float *runs[2]) const
+    {
+        const auto start = m_read.load(std::memory_order_relaxed) & m_mask;
+        const auto first = std::min(count, m_capacity - start);
+        runs[0] = &m_buf[start];
+        runs[1] = &m_buf[0];
+        return first;
+    }
+
+    // consumer: remove the oldest count samples, copying them to dst if it is not null
+    // caller must ensure size() >= count
+    void pop_front(float *dst, size_t count)
+    {
+        const auto read = m_read.load(std::memory_order_relaxed);
+        if(dst != nullptr)
+            copy_out(dst, read, count);
+        m_read.store(read + count, std::memory_order_release);
+    }
+
+    // consumer: discard everything currently in the buffer
+    void clear()
+    {
+        m_read.store(m_write.load(std::memory_order_acquire), std::memory_order_release);
+    }
+};
@@ -57,6 +57,23 @@ static inline bool p_equ(const char *s1, const char *s2) { return std::strcmp(s1
 #define P_AUTO_FFT_SIZE     "auto_fft_size"
 #define P_FFT_SIZE          "fft_size"
 
+#define P_HOP_SIZE          "hop_size"
+#define P_HOP_HALF          "hop_half"
+#define P_HOP_QUARTER       "hop_quarter"
+#define P_HOP_EIGHTH        "hop_eighth"
+#define P_HOP_COMBINE       "hop_combine"
+#define P_WELCH             "welch"
+#define P_MAX               "max"
+#define P_DECIMATE          "decimate"
+#define P_DOMAIN            "processing_domain"
+#define P_MAGNITUDE         "magnitude"
+#define P_POWER             "power"
+#define P_SILENCE_GATE      "silence_gate"
+#define P_GATE_LEVEL        "silence_gate_level"
+
+#define P_ANALYSIS_THREAD   "analysis_thread"
+#define P_STATS_INTERVAL    "stats_interval"
+
 #define P_CHANNEL_MODE      "channel_mode"
 #define P_MONO              "mono"
 #define P_STEREO            "stereo"
@@ -70,6 +87,7 @@ static inline bool p_equ(const char *s1, const char *s2) { return std::strcmp(s1
 #define P_FILTER_MODE       "filter_mode"
 #define P_FILTER_RADIUS     "filter_radius"
 #define P_GAUSS             "gauss"
+#define P_RECURSIVE_GAUSS   "recursive_gauss"
 
 #define P_CUTOFF_LOW        "cutoff_low"
 #define P_CUTOFF_HIGH       "cutoff_high"
@@ -101,12 +119,21 @@ static inline bool p_equ(const char *s1, const char *s2) { return std::strcmp(s1
 #define P_STEP_WIDTH        "step_width"
 #define P_STEP_GAP          "step_gap"
 
+#define P_AGGREGATION       "bar_aggregation"
+#define P_AVERAGE_DB        "average_db"
+#define P_ENERGY_SUM        "energy_sum"
+
 
 // tooltip descriptions
 #define P_CHAN_DESC         "chan_desc"
 #define P_AUTO_FFT_DESC     "auto_fft_desc"
 #define P_FFT_DESC          "fft_desc"
 #define P_WINDOW_DESC       "window_desc"
+#define P_HOP_DESC          "hop_desc"
+#define P_HOP_COMBINE_DESC  "hop_combine_desc"
+#define P_DECIMATE_DESC     "decimate_desc"
+#define P_DOMAIN_DESC       "processing_domain_desc"
+#define P_GATE_DESC         "silence_gate_desc"
 #define P_TEMPORAL_DESC     "temporal_desc"
 #define P_GRAVITY_DESC      "gravity_desc"
 #define P_FAST_PEAKS_DESC   "fast_peaks_desc"
@@ -115,3 +142,6 @@ static inline bool p_equ(const char *s1, const char *s2) { return std::strcmp(s1
 #define P_SLOPE_DESC        "slope_desc"
 #define P_DEADZONE_DESC     "deadzone_desc"
 #define P_CAPS_DESC         "caps_desc"
+#define P_AGGREGATION_DESC  "bar_aggregation_desc"
+#define P_ANALYSIS_THREAD_DESC "analysis_thread_desc"
+#define P_STATS_INTERVAL_DESC "stats_interval_desc"
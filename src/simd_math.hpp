@@ -0,0 +1,151 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "waveform_config.hpp"
+#include <immintrin.h>
+#include <cfloat>
+#include <cstddef>
+
+// vectorized 20 * log10(x) for magnitude to dBFS conversion
+// x is split into mantissa m in [sqrt(0.5), sqrt(2)) and exponent e, then ln(m) is approximated with the
+// cephes logf polynomial and dB = (ln(m) + e * ln(2)) * 20 / ln(10)
+// max absolute error vs. 20 * std::log10 is below 1e-4 dB over all normal floats, mostly rounding of the result
+// inputs <= FLT_MIN (zero, negative, denormal, NaN) return 20 * log10(FLT_MIN), matching WAVSource::DB_MIN
+// passing DB_PER_LN_POWER instead converts power with 10 * log10(x) at no extra cost
+// both bounds are checked by waveform-cli --check-isa
+namespace simd_math {
+    constexpr float DB_PER_LN = 8.68588963806503655302f;    // 20 / ln(10)
+    constexpr float DB_PER_LN_POWER = 4.34294481903251827651f;  // 10 / ln(10)
+    constexpr float LN2 = 0.693147180559945309417f;
+    constexpr float SQRT2 = 1.41421356237309504880f;
+
+    // ln(1 + x) - x for x in [sqrt(0.5) - 1, sqrt(2) - 1]
+    constexpr float P0 = 7.0376836292e-2f;
+    constexpr float P1 = -1.1514610310e-1f;
+    constexpr float P2 = 1.1676998740e-1f;
+    constexpr float P3 = -1.2420140846e-1f;
+    constexpr float P4 = 1.4249322787e-1f;
+    constexpr float P5 = -1.6668057665e-1f;
+    constexpr float P6 = 2.0000714765e-1f;
+    constexpr float P7 = -2.4999993993e-1f;
+    constexpr float P8 = 3.3333331174e-1f;
+}
+
+DECORATE_AVX2
+static inline __m256 dbfs_avx2(__m256 x, float db_per_ln = simd_math::DB_PER_LN)
+{
+    using namespace simd_math;
+    x = _mm256_max_ps(x, _mm256_set1_ps(FLT_MIN));
+
+    // split into exponent and mantissa in [1, 2)
+    const auto xi = _mm256_castps_si256(x);
+    auto e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(xi, 23), _mm256_set1_epi32(127)));
+    auto m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(xi, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+
+    // shift mantissa into [sqrt(0.5), sqrt(2)) to keep the polynomial argument small
+    const auto big = _mm256_cmp_ps(m, _mm256_set1_ps(SQRT2), _CMP_GE_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    e = _mm256_add_ps(e, _mm256_and_ps(big, _mm256_set1_ps(1.0f)));
+    const auto f = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+
+    // ln(1 + f)
+    auto p = _mm256_set1_ps(P0);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P1));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P2));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P3));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P4));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P5));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P6));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P7));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P8));
+    const auto f2 = _mm256_mul_ps(f, f);
+    p = _mm256_mul_ps(_mm256_mul_ps(p, f), f2);
+    p = _mm256_fmadd_ps(_mm256_set1_ps(-0.5f), f2, p);
+    const auto ln = _mm256_add_ps(f, p);
+
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(LN2 * db_per_ln), _mm256_mul_ps(ln, _mm256_set1_ps(db_per_ln)));
+}
+
+// AVX without AVX2 has no 256-bit integer ops, the exponent is extracted from 128-bit halves
+DECORATE_AVX
+static inline __m256 dbfs_avx(__m256 x, float db_per_ln = simd_math::DB_PER_LN)
+{
+    using namespace simd_math;
+    x = _mm256_max_ps(x, _mm256_set1_ps(FLT_MIN));
+
+    const auto xi = _mm256_castps_si256(x);
+    const auto bias = _mm_set1_epi32(127);
+    const auto elo = _mm_sub_epi32(_mm_srli_epi32(_mm256_castsi256_si128(xi), 23), bias);
+    const auto ehi = _mm_sub_epi32(_mm_srli_epi32(_mm256_extractf128_si256(xi, 1), 23), bias);
+    auto e = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(elo), ehi, 1));
+    auto m = _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x007fffff))), _mm256_set1_ps(1.0f));
+
+    const auto big = _mm256_cmp_ps(m, _mm256_set1_ps(SQRT2), _CMP_GE_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+    e = _mm256_add_ps(e, _mm256_and_ps(big, _mm256_set1_ps(1.0f)));
+    const auto f = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+
+    auto p = _mm256_set1_ps(P0);
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P1));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P2));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P3));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P4));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P5));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P6));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P7));
+    p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(P8));
+    const auto f2 = _mm256_mul_ps(f, f);
+    p = _mm256_mul_ps(_mm256_mul_ps(p, f), f2);
+    p = _mm256_fmadd_ps(_mm256_set1_ps(-0.5f), f2, p);
+    const auto ln = _mm256_add_ps(f, p);
+
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(LN2 * db_per_ln), _mm256_mul_ps(ln, _mm256_set1_ps(db_per_ln)));
+}
+
+DECORATE_SSE2
+static inline __m128 dbfs_sse2(__m128 x, float db_per_ln = simd_math::DB_PER_LN)
+{
+    using namespace simd_math;
+    x = _mm_max_ps(x, _mm_set1_ps(FLT_MIN));
+
+    const auto xi = _mm_castps_si128(x);
+    auto e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(xi, 23), _mm_set1_epi32(127)));
+    auto m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(xi, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+
+    // no blendv in SSE2
+    const auto big = _mm_cmpge_ps(m, _mm_set1_ps(SQRT2));
+    m = _mm_or_ps(_mm_andnot_ps(big, m), _mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))));
+    e = _mm_add_ps(e, _mm_and_ps(big, _mm_set1_ps(1.0f)));
+    const auto f = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+
+    auto p = _mm_set1_ps(P0);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P1));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P2));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P3));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P4));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P5));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P6));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P7));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(P8));
+    const auto f2 = _mm_mul_ps(f, f);
+    p = _mm_mul_ps(_mm_mul_ps(p, f), f2);
+    p = _mm_sub_ps(p, _mm_mul_ps(_mm_set1_ps(0.5f), f2));
+    const auto ln = _mm_add_ps(f, p);
+
+    return _mm_add_ps(_mm_mul_ps(e, _mm_set1_ps(LN2 * db_per_ln)), _mm_mul_ps(ln, _mm_set1_ps(db_per_ln)));
+}
@@ -19,7 +19,11 @@
 #include "math_funcs.hpp"
 #include "source.hpp"
 #include "settings.hpp"
+#include "analysis_worker.hpp"
+#include "config_builder.hpp"
+#include "analysis_engine.hpp"
 #include <graphics/matrix4.h>
+#include <callback/proc.h>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -91,6 +95,12 @@ namespace callbacks {
         delete static_cast<WAVSource*>(data);
     }
 
+    // proc "void get_stats(out string stats)", per stage timing as JSON
+    static void get_stats(void *data, calldata_t *cd)
+    {
+        calldata_set_string(cd, "stats", static_cast<WAVSource*>(data)->stats().to_json().c_str());
+    }
+
     static uint32_t get_width(void *data)
     {
         return static_cast<WAVSource*>(data)->width();
@@ -116,7 +126,15 @@ namespace callbacks {
         obs_data_set_default_int(settings, P_CHANNEL_SPACING, 0);
         obs_data_set_default_int(settings, P_FFT_SIZE, 2048);
         obs_data_set_default_bool(settings, P_AUTO_FFT_SIZE, false);
+        obs_data_set_default_bool(settings, P_ANALYSIS_THREAD, false);
+        obs_data_set_default_int(settings, P_STATS_INTERVAL, 0);
         obs_data_set_default_string(settings, P_WINDOW, P_HANN);
+        obs_data_set_default_string(settings, P_HOP_SIZE, P_NONE);
+        obs_data_set_default_string(settings, P_HOP_COMBINE, P_WELCH);
+        obs_data_set_default_bool(settings, P_DECIMATE, false);
+        obs_data_set_default_string(settings, P_DOMAIN, P_MAGNITUDE);
+        obs_data_set_default_bool(settings, P_SILENCE_GATE, false);
+        obs_data_set_default_int(settings, P_GATE_LEVEL, -90);
         obs_data_set_default_string(settings, P_INTERP_MODE, P_LANCZOS);
         obs_data_set_default_string(settings, P_FILTER_MODE, P_NONE);
         obs_data_set_default_double(settings, P_FILTER_RADIUS, 1.5);
@@ -136,6 +154,7 @@ namespace callbacks {
         obs_data_set_default_int(settings, P_BAR_GAP, 6);
         obs_data_set_default_int(settings, P_STEP_WIDTH, 8);
         obs_data_set_default_int(settings, P_STEP_GAP, 4);
+        obs_data_set_default_string(settings, P_AGGREGATION, P_AVERAGE_DB);
         obs_data_set_default_int(settings, P_METER_BUF, 150);
         obs_data_set_default_bool(settings, P_RMS_MODE, true);
         obs_data_set_default_bool(settings, P_HIDE_SILENT, false);
@@ -179,6 +198,7 @@ namespace callbacks {
             set_prop_visible(props, P_STEP_WIDTH, step);
             set_prop_visible(props, P_STEP_GAP, step);
             set_prop_visible(props, P_CAPS, bar);
+            set_prop_visible(props, P_AGGREGATION, p_equ(disp, P_BARS) || p_equ(disp, P_STEP_BARS));
             obs_property_list_item_disable(obs_properties_get(props, P_RENDER_MODE), 0, !curve);
 
             // meter mode
@@ -192,6 +212,12 @@ namespace callbacks {
             set_prop_visible(props, P_CHANNEL_MODE, notmeter);
             set_prop_visible(props, P_CHANNEL_SPACING, notmeter && p_equ(obs_data_get_string(settings, P_CHANNEL_MODE), P_STEREO));
             set_prop_visible(props, P_WINDOW, notmeter);
+            set_prop_visible(props, P_HOP_SIZE, notmeter);
+            set_prop_visible(props, P_HOP_COMBINE, notmeter && !p_equ(obs_data_get_string(settings, P_HOP_SIZE), P_NONE));
+            set_prop_visible(props, P_DECIMATE, notmeter);
+            set_prop_visible(props, P_DOMAIN, notmeter);
+            set_prop_visible(props, P_SILENCE_GATE, notmeter);
+            set_prop_visible(props, P_GATE_LEVEL, notmeter && obs_data_get_bool(settings, P_SILENCE_GATE));
             set_prop_visible(props, P_RADIAL, notmeter);
             set_prop_visible(props, P_DEADZONE, notmeter && obs_data_get_bool(settings, P_RADIAL));
             set_prop_visible(props, P_INVERT, notmeter && obs_data_get_bool(settings, P_RADIAL));
@@ -228,6 +254,12 @@ namespace callbacks {
         auto caps = obs_properties_add_bool(props, P_CAPS, T(P_CAPS));
         obs_property_set_long_description(caps, T(P_CAPS_DESC));
 
+        // bar aggregation
+        auto aggregationlist = obs_properties_add_list(props, P_AGGREGATION, T(P_AGGREGATION), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+        obs_property_list_add_string(aggregationlist, T(P_AVERAGE_DB), P_AVERAGE_DB);
+        obs_property_list_add_string(aggregationlist, T(P_ENERGY_SUM), P_ENERGY_SUM);
+        obs_property_set_long_description(aggregationlist, T(P_AGGREGATION_DESC));
+
         // meter
         obs_properties_add_bool(props, P_RMS_MODE, T(P_RMS_MODE));
         auto meterbuf = obs_properties_add_int_slider(props, P_METER_BUF, T(P_METER_BUF), 16, 1000, 1);
@@ -267,6 +299,52 @@ namespace callbacks {
         obs_property_list_add_string(wndlist, T(P_BLACKMAN_HARRIS), P_BLACKMAN_HARRIS);
         obs_property_set_long_description(wndlist, T(P_WINDOW_DESC));
 
+        // hop size
+        auto hoplist = obs_properties_add_list(props, P_HOP_SIZE, T(P_HOP_SIZE), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+        obs_property_list_add_string(hoplist, T(P_NONE), P_NONE);
+        obs_property_list_add_string(hoplist, T(P_HOP_HALF), P_HOP_HALF);
+        obs_property_list_add_string(hoplist, T(P_HOP_QUARTER), P_HOP_QUARTER);
+        obs_property_list_add_string(hoplist, T(P_HOP_EIGHTH), P_HOP_EIGHTH);
+        auto combinelist = obs_properties_add_list(props, P_HOP_COMBINE, T(P_HOP_COMBINE), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+        obs_property_list_add_string(combinelist, T(P_WELCH), P_WELCH);
+        obs_property_list_add_string(combinelist, T(P_MAX), P_MAX);
+        obs_property_set_long_description(hoplist, T(P_HOP_DESC));
+        obs_property_set_long_description(combinelist, T(P_HOP_COMBINE_DESC));
+        obs_property_set_modified_callback(hoplist, [](obs_properties_t *props, [[maybe_unused]] obs_property_t *property, obs_data_t *settings) -> bool {
+            auto enable = !p_equ(obs_data_get_string(settings, P_HOP_SIZE), P_NONE) && obs_property_visible(obs_properties_get(props, P_HOP_SIZE));
+            set_prop_visible(props, P_HOP_COMBINE, enable);
+            return true;
+            });
+
+        // decimation
+        auto decimate = obs_properties_add_bool(props, P_DECIMATE, T(P_DECIMATE));
+        obs_property_set_long_description(decimate, T(P_DECIMATE_DESC));
+
+        // processing domain
+        auto domainlist = obs_properties_add_list(props, P_DOMAIN, T(P_DOMAIN), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+        obs_property_list_add_string(domainlist, T(P_MAGNITUDE), P_MAGNITUDE);
+        obs_property_list_add_string(domainlist, T(P_POWER), P_POWER);
+        obs_property_set_long_description(domainlist, T(P_DOMAIN_DESC));
+
+        // silence gate
+        auto gate = obs_properties_add_bool(props, P_SILENCE_GATE, T(P_SILENCE_GATE));
+        auto gatelevel = obs_properties_add_int_slider(props, P_GATE_LEVEL, T(P_GATE_LEVEL), -150, -20, 1);
+        obs_property_int_set_suffix(gatelevel, " dBFS");
+        obs_property_set_long_description(gate, T(P_GATE_DESC));
+        obs_property_set_modified_callback(gate, [](obs_properties_t *props, [[maybe_unused]] obs_property_t *property, obs_data_t *settings) -> bool {
+            auto enable = obs_data_get_bool(settings, P_SILENCE_GATE) && obs_property_visible(obs_properties_get(props, P_SILENCE_GATE));
+            set_prop_visible(props, P_GATE_LEVEL, enable);
+            return true;
+            });
+
+        // analysis thread
+        auto athread = obs_properties_add_bool(props, P_ANALYSIS_THREAD, T(P_ANALYSIS_THREAD));
+        obs_property_set_long_description(athread, T(P_ANALYSIS_THREAD_DESC));
+
+        // timing statistics
+        auto statsint = obs_properties_add_int(props, P_STATS_INTERVAL, T(P_STATS_INTERVAL), 0, 3600, 1);
+        obs_property_set_long_description(statsint, T(P_STATS_INTERVAL_DESC));
+
         // smoothing
         auto tsmoothlist = obs_properties_add_list(props, P_TSMOOTHING, T(P_TSMOOTHING), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
         obs_property_list_add_string(tsmoothlist, T(P_NONE), P_NONE);
@@ -293,6 +371,7 @@ namespace callbacks {
         auto filterlist = obs_properties_add_list(props, P_FILTER_MODE, T(P_FILTER_MODE), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
         obs_property_list_add_string(filterlist, T(P_NONE), P_NONE);
         obs_property_list_add_string(filterlist, T(P_GAUSS), P_GAUSS);
+        obs_property_list_add_string(filterlist, T(P_RECURSIVE_GAUSS), P_RECURSIVE_GAUSS);
         obs_properties_add_float_slider(props, P_FILTER_RADIUS, T(P_FILTER_RADIUS), 0.0, 32.0, 0.01);
         obs_property_set_long_description(filterlist, T(P_FILTER_DESC));
         obs_property_set_modified_callback(filterlist, [](obs_properties_t *props, [[maybe_unused]] obs_property_t *property, obs_data_t *settings) -> bool {
@@ -353,19 +432,9 @@ namespace callbacks {
     {
         static_cast<WAVSource*>(data)->render(effect);
     }
-
-    static void capture_audio(void *data, obs_source_t *source, const audio_data *audio, bool muted)
-    {
-        static_cast<WAVSource*>(data)->capture_audio(source, audio, muted);
-    }
-
-    static void capture_output_bus(void *param, size_t mix_idx, audio_data *data)
-    {
-        static_cast<WAVSource*>(param)->capture_output_bus(mix_idx, data);
-    }
 }
 
-void WAVSource::get_settings(obs_data_t *settings)
+void SourceSettings::load(obs_data_t *settings)
 {
     auto src_name = obs_data_get_string(settings, P_AUDIO_SRC);
     m_width = (unsigned int)obs_data_get_int(settings, P_WIDTH);
@@ -380,6 +449,12 @@ void WAVSource::get_settings(obs_data_t *settings)
     m_fft_size = (size_t)obs_data_get_int(settings, P_FFT_SIZE);
     m_auto_fft_size = obs_data_get_bool(settings, P_AUTO_FFT_SIZE);
     auto wnd = obs_data_get_string(settings, P_WINDOW);
+    auto hop = obs_data_get_string(settings, P_HOP_SIZE);
+    auto hopcombine = obs_data_get_string(settings, P_HOP_COMBINE);
+    m_decimate = obs_data_get_bool(settings, P_DECIMATE);
+    m_power_domain = p_equ(obs_data_get_string(settings, P_DOMAIN), P_POWER);
+    m_silence_gate = obs_data_get_bool(settings, P_SILENCE_GATE);
+    m_gate_level = (int)obs_data_get_int(settings, P_GATE_LEVEL);
     auto tsmoothing = obs_data_get_string(settings, P_TSMOOTHING);
     m_gravity = (float)obs_data_get_double(settings, P_GRAVITY);
     m_fast_peaks = obs_data_get_bool(settings, P_FAST_PEAKS);
@@ -400,9 +475,12 @@ void WAVSource::get_settings(obs_data_t *settings)
     m_bar_gap = (int)obs_data_get_int(settings, P_BAR_GAP);
     m_step_width = (int)obs_data_get_int(settings, P_STEP_WIDTH);
     m_step_gap = (int)obs_data_get_int(settings, P_STEP_GAP);
+    auto aggregation = obs_data_get_string(settings, P_AGGREGATION);
     m_meter_rms = obs_data_get_bool(settings, P_RMS_MODE);
     m_meter_ms = (int)obs_data_get_int(settings, P_METER_BUF);
     m_hide_on_silent = obs_data_get_bool(settings, P_HIDE_SILENT);
+    m_async_analysis = obs_data_get_bool(settings, P_ANALYSIS_THREAD);
+    m_stats_interval = (int)obs_data_get_int(settings, P_STATS_INTERVAL);
 
     m_color_base = { (uint8_t)color_base / 255.0f, (uint8_t)(color_base >> 8) / 255.0f, (uint8_t)(color_base >> 16) / 255.0f, (uint8_t)(color_base >> 24) / 255.0f };
     m_color_crest = { (uint8_t)color_crest / 255.0f, (uint8_t)(color_crest >> 8) / 255.0f, (uint8_t)(color_crest >> 16) / 255.0f, (uint8_t)(color_crest >> 24) / 255.0f };
@@ -443,6 +521,20 @@ void WAVSource::get_settings(obs_data_t *settings)
     else
         m_window_func = FFTWindow::NONE;
 
+    if(p_equ(hop, P_HOP_HALF))
+        m_hop_divisor = 2;
+    else if(p_equ(hop, P_HOP_QUARTER))
+        m_hop_divisor = 4;
+    else if(p_equ(hop, P_HOP_EIGHTH))
+        m_hop_divisor = 8;
+    else
+        m_hop_divisor = 0;
+
+    if(p_equ(hopcombine, P_MAX))
+        m_hop_combine = HopCombine::MAX;
+    else
+        m_hop_combine = HopCombine::AVERAGE;
+
     if(p_equ(interp, P_LANCZOS))
         m_interp_mode = InterpMode::LANCZOS;
     else
@@ -450,6 +542,8 @@ void WAVSource::get_settings(obs_data_t *settings)
 
     if(p_equ(filtermode, P_GAUSS))
         m_filter_mode = FilterMode::GAUSS;
+    else if(p_equ(filtermode, P_RECURSIVE_GAUSS))
+        m_filter_mode = FilterMode::RECURSIVE_GAUSS;
     else
         m_filter_mode = FilterMode::NONE;
 
@@ -486,6 +580,8 @@ void WAVSource::get_settings(obs_data_t *settings)
         m_meter_mode = true;
     }
 
+    m_energy_bars = ((m_display_mode == DisplayMode::BAR) || (m_display_mode == DisplayMode::STEPPED_BAR)) && p_equ(aggregation, P_ENERGY_SUM);
+
     if(m_radial)
     {
         m_height /= 2; // fit diameter to hieght of bounding box
@@ -497,154 +593,236 @@ void WAVSource::get_settings(obs_data_t *settings)
     }
 }
 
-void WAVSource::recapture_audio()
+// interpolation positions between the low and high cutoff bins
+static std::vector<float> make_interp_indices(const SourceSettings& settings, unsigned int sz)
 {
-    // release old capture
-    release_audio_capture();
-
-    // add new capture
-    auto src_name = m_audio_source_name.c_str();
-    if(p_equ(src_name, P_OUTPUT_BUS))
+    const auto fft_size = settings.m_fft_size;
+    const auto maxbin = (fft_size / 2) - 1;
+    const auto sr = (float)settings.m_audio_info.samples_per_sec;
+    const auto lowbin = std::clamp((float)settings.m_cutoff_low * fft_size / sr, 1.0f, (float)maxbin);
+    const auto highbin = std::clamp((float)settings.m_cutoff_high * fft_size / sr, 1.0f, (float)maxbin);
+
+    std::vector<float> indices(sz);
+    if(settings.m_log_scale)
     {
-        audio_convert_info cvt{};
-        cvt.format = audio_format::AUDIO_FORMAT_FLOAT_PLANAR;
-        cvt.samples_per_sec = m_audio_info.samples_per_sec;
-        cvt.speakers = (m_audio_info.speakers != speaker_layout::SPEAKERS_UNKNOWN) ? m_audio_info.speakers : speaker_layout::SPEAKERS_STEREO;
-        m_output_bus_captured = audio_output_connect(obs_get_audio(), 0, &cvt, &callbacks::capture_output_bus, this);
+        for(auto i = 0u; i < sz; ++i)
+            indices[i] = log_interp(lowbin, highbin, (float)i / (float)(sz - 1));
     }
     else
     {
-        auto asrc = obs_get_source_by_name(src_name);
-        if(asrc != nullptr)
-        {
-            obs_source_add_audio_capture_callback(asrc, &callbacks::capture_audio, this);
-            m_audio_source = obs_source_get_weak_source(asrc);
-            obs_source_release(asrc);
-        }
-        else if(!p_equ(src_name, "none"))
-        {
-            if(m_retries++ == 0)
-                blog(LOG_WARNING, "[" MODULE_NAME "]: Failed to get audio source: \"%s\"", src_name);
-        }
+        for(auto i = 0u; i < sz; ++i)
+            indices[i] = lerp(lowbin, highbin, (float)i / (float)(sz - 1));
     }
+    return indices;
 }
 
-void WAVSource::release_audio_capture()
+// aligned runs of bins that interp_channel() reads with this layout
+static void set_bin_runs(InterpLayout& layout, size_t len)
 {
-    if(m_audio_source != nullptr)
+    // mark every block of 8 bins that is read
+    std::vector<bool> blocks((len + 7) / 8, false);
+    const auto mark = [&](size_t first, size_t last) {
+        for(auto i = first / 8; i < std::min((last + 7) / 8, blocks.size()); ++i)
+            blocks[i] = true;
+    };
+    if(layout.bars.rows() > 0)
     {
-        auto src = obs_weak_source_get_source(m_audio_source);
-        obs_weak_source_release(m_audio_source);
-        m_audio_source = nullptr;
-        if(src != nullptr)
-        {
-            obs_source_remove_audio_capture_callback(src, &callbacks::capture_audio, this);
-            obs_source_release(src);
-        }
+        for(size_t i = 0; i < layout.bars.rows(); ++i)
+            mark(layout.bars.columns[i], layout.bars.columns[i] + layout.bars.offsets[i + 1] - layout.bars.offsets[i]);
     }
-
-    if(m_output_bus_captured)
+    else if(layout.table.count > 0)
+    {
+        for(size_t i = 0; i < layout.table.count; ++i)
+            mark(layout.table.starts[i], layout.table.starts[i] + InterpTable::TAPS);
+    }
+    else
     {
-        audio_output_disconnect(obs_get_audio(), 0, &callbacks::capture_output_bus, this);
-        m_output_bus_captured = false;
+        for(auto i : layout.indices)
+            mark((size_t)i, (size_t)i + 1);
     }
 
-    // reset circular buffers
-    for(auto& i : m_capturebufs)
+    layout.bin_runs.clear();
+    for(size_t i = 0; i < blocks.size(); ++i)
     {
-        i.end_pos = 0;
-        i.start_pos = 0;
-        i.size = 0;
+        if(!blocks[i])
+            continue;
+        if(!layout.bin_runs.empty() && (layout.bin_runs.back().second == i * 8))
+            layout.bin_runs.back().second = std::min((i + 1) * 8, len);
+        else
+            layout.bin_runs.emplace_back(i * 8, std::min((i + 1) * 8, len));
     }
 }
 
-bool WAVSource::check_audio_capture(float seconds)
+static std::shared_ptr<const InterpLayout> make_interp_layout(const SourceSettings& settings)
 {
-    if(m_output_bus_captured)
-        return true;
-
-    if(m_audio_source == nullptr)
+    auto layout = std::make_shared<InterpLayout>();
+    if(settings.m_meter_mode)
+        return layout;
+    const auto len = settings.m_fft_size / 2;
+    if(settings.m_display_mode == DisplayMode::CURVE)
     {
-        m_next_retry -= seconds;
-        if(m_next_retry <= 0.0f)
+        layout->indices = make_interp_indices(settings, settings.m_width);
+        if(settings.m_interp_mode == InterpMode::LANCZOS)
         {
-            m_next_retry = RETRY_DELAY;
-            recapture_audio();
-            if(m_audio_source != nullptr)
-                return true;
+            layout->table = make_lanczos_table(layout->indices.data(), layout->indices.size(), len, 3.0f);
+            layout->weight_sums.assign(layout->table.count, 0.0f);
+            for(size_t i = 0; i < layout->table.count; ++i)
+                for(auto tap = 0; tap < InterpTable::TAPS; ++tap)
+                    layout->weight_sums[i] += layout->table.weights[(tap * layout->table.padded) + i];
         }
-        return false;
     }
-
-    // check if the source still exists
-    auto src = obs_weak_source_get_source(m_audio_source);
-    if(src == nullptr)
+    else
     {
-        release_audio_capture();
-        return false;
-    }
-    obs_source_release(src);
-    return true;
-}
+        // each bar reduces to one weighted sum over a run of bins
+        // average the (interpolated) bins within the bar, or add up their power
+        layout->indices = make_interp_indices(settings, settings.m_num_bars + 1); // make extra band for last bar
+        const auto average = !settings.m_energy_bars;
+        if(settings.m_interp_mode == InterpMode::LANCZOS)
+        {
+            // interpolate at every whole bin step within the bar
+            std::vector<float> positions;
+            std::vector<uint32_t> bar_points;
+            bar_points.reserve(settings.m_num_bars + 1);
+            for(auto i = 0; i < settings.m_num_bars; ++i)
+            {
+                bar_points.push_back((uint32_t)positions.size());
+                auto pos = layout->indices[i];
+                const auto stop = layout->indices[i + 1];
+                do
+                {
+                    positions.push_back(pos);
+                    pos += 1.0f;
+                } while(pos < stop);
+            }
+            bar_points.push_back((uint32_t)positions.size());
+            const auto table = make_lanczos_table(positions.data(), positions.size(), len, 3.0f);
+            layout->bars = make_band_matrix(table, bar_points, average);
+        }
+        else
+            layout->bars = make_band_matrix(layout->indices.data(), settings.m_num_bars, average);
 
-void WAVSource::free_bufs()
-{
-    for(auto i = 0; i < 2; ++i)
-    {
-        m_decibels[i].reset();
-        m_tsmooth_buf[i].reset();
+        // energy sums are converted to dB after the matrix, so an offset carries through them unchanged
+        if(average)
+        {
+            layout->weight_sums.assign(layout->bars.rows(), 0.0f);
+            for(size_t i = 0; i < layout->bars.rows(); ++i)
+                for(auto j = layout->bars.offsets[i]; j < layout->bars.offsets[i + 1]; ++j)
+                    layout->weight_sums[i] += layout->bars.weights[j];
+        }
     }
 
-    m_fft_input.reset();
-    m_fft_output.reset();
-    m_window_coefficients.reset();
-    m_slope_modifiers.reset();
+    set_bin_runs(*layout, len);
+    return layout;
+}
 
-    if(m_fft_plan != nullptr)
+void WAVSource::filter_interp(unsigned int channel, StageClock& clock)
+{
+    if(m_filter_mode != FilterMode::NONE)
+        clock.begin(Stage::FILTER);
+    if(m_filter_mode == FilterMode::RECURSIVE_GAUSS)
+        apply_recursive_gauss(m_interp_bufs[channel], m_filter->recursive_gauss, m_filter_buf); // only holds the tail in this mode
+    else if(m_filter_mode == FilterMode::GAUSS)
     {
-        fftwf_destroy_plan(m_fft_plan);
-        m_fft_plan = nullptr;
+        if(HAVE_AVX)
+            apply_filter_fma3(m_interp_bufs[channel], m_filter->kernel, m_filter_buf);
+        else
+            apply_filter(m_interp_bufs[channel], m_filter->kernel, m_filter_buf);
+        std::swap(m_interp_bufs[channel], m_filter_buf);
     }
-
-    m_fft_size = 0;
 }
 
-void WAVSource::init_interp(unsigned int sz)
+// spectrum -> m_interp_bufs[channel] in dB, one value per curve point or bar
+void WAVSource::interp_channel(unsigned int channel, const float *decibels, float decay_db, StageClock& clock)
 {
-    const auto maxbin = (m_fft_size / 2) - 1;
-    const auto sr = (float)m_audio_info.samples_per_sec;
-    const auto lowbin = std::clamp((float)m_cutoff_low * m_fft_size / sr, 1.0f, (float)maxbin);
-    const auto highbin = std::clamp((float)m_cutoff_high * m_fft_size / sr, 1.0f, (float)maxbin);
-
-    m_interp_indices.resize(sz);
-    if(m_log_scale)
+    clock.begin(Stage::INTERP);
+    if(m_display_mode == DisplayMode::CURVE)
     {
-        for(auto i = 0u; i < sz; ++i)
-            m_interp_indices[i] = log_interp(lowbin, highbin, (float)i / (float)(sz - 1));
+        if(m_interp_mode == InterpMode::LANCZOS)
+        {
+            if(HAVE_AVX2)
+                apply_interp_avx2(m_interp->table, decibels, m_interp_bufs[channel].data());
+            else
+                apply_interp(m_interp->table, decibels, m_interp_bufs[channel].data());
+        }
+        else
+            for(auto i = 0u; i < m_width; ++i)
+                m_interp_bufs[channel][i] = decibels[(int)m_interp->indices[i]];
+    }
+    else if(m_energy_bars)
+    {
+        // decibels holds magnitudes (or powers) in this mode, only the per bar sums are converted
+        // magnitudes are squared on the way into the sums
+        if(m_power_domain)
+        {
+            if(HAVE_AVX2)
+                apply_band_matrix_avx2<false>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+            else
+                apply_band_matrix<false>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+        }
+        else if(HAVE_AVX2)
+            apply_band_matrix_avx2<true>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+        else
+            apply_band_matrix<true>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+        for(auto& i : m_interp_bufs[channel])
+            i = (i > 0.0f) ? 10.0f * std::log10(i) : DB_MIN;
     }
     else
     {
-        for(auto i = 0u; i < sz; ++i)
-            m_interp_indices[i] = lerp(lowbin, highbin, (float)i / (float)(sz - 1));
+        if(HAVE_AVX2)
+            apply_band_matrix_avx2<false>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+        else
+            apply_band_matrix<false>(m_interp->bars, decibels, m_interp_bufs[channel].data());
+    }
+
+    // decibels is still the spectrum from before the fade, see decay_silence()
+    if(decay_db != 0.0f)
+    {
+        auto& buf = m_interp_bufs[channel];
+        const auto& sums = m_interp->weight_sums;
+        for(size_t i = 0; i < buf.size(); ++i)
+            buf[i] += sums.empty() ? decay_db : (decay_db * sums[i]);
     }
+
+    filter_interp(channel, clock);
 }
 
-WAVSource::WAVSource(obs_data_t *settings, obs_source_t *source)
+WAVSource::WAVSource(obs_data_t *settings, obs_source_t *source, SIMDLevel simd, const SpectrumKernelTable& spectrum_kernels) : m_simd(simd), m_spectrum_kernels(spectrum_kernels)
 {
     m_source = source;
-    for(auto& i : m_capturebufs)
-        circlebuf_init(&i);
-    update(settings);
+
+    // the first config is built right away, the source has to be usable as soon as it exists
+    SourceSettings initial;
+    initial.load(settings);
+    initial.derive();
+    {
+        std::lock_guard lock(m_mtx);
+        apply_config(*build_config(initial));
+    }
+    if(m_source != nullptr)
+        proc_handler_add(obs_source_get_proc_handler(m_source), "void get_stats(out string stats)", &callbacks::get_stats, this);
 }
 
 WAVSource::~WAVSource()
 {
-    std::lock_guard lock(m_mtx);
-    release_audio_capture();
-    free_bufs();
+    ConfigBuilder::get().remove(this);
+    delete m_pending.exchange(nullptr);
+    m_latest.reset();
+
+    {
+        std::lock_guard lock(m_mtx);
+        AnalysisWorker::get().remove(this);
+        std::lock_guard analysis_lock(m_analysis_mtx);
+        m_engine.reset();
+    }
 
-    for(auto& i : m_capturebufs)
-        circlebuf_free(&i);
+    // don't enter graphics while holding m_mtx, render() takes it from inside the graphics thread
+    if(m_vbuf != nullptr)
+    {
+        obs_enter_graphics();
+        gs_vertexbuffer_destroy(m_vbuf);
+        obs_leave_graphics();
+        m_vbuf = nullptr;
+    }
 }
 
 unsigned int WAVSource::width()
@@ -669,12 +847,16 @@ unsigned int WAVSource::height()
 
 void WAVSource::update(obs_data_t *settings)
 {
-    std::lock_guard lock(m_mtx);
-
-    release_audio_capture();
-    free_bufs();
-    get_settings(settings);
+    // parsing is cheap, the rest is built on the ConfigBuilder thread and swapped in by the next tick()
+    // so tick() and render() are never blocked by a rebuild
+    SourceSettings requested;
+    requested.load(settings);
+    requested.derive();
+    ConfigBuilder::get().enqueue(this, requested);
+}
 
+void SourceSettings::derive()
+{
     // get current audio settings
     update_audio_info(&m_audio_info);
     m_capture_channels = std::min(get_audio_channels(m_audio_info.speakers), 2u);
@@ -706,14 +888,12 @@ void WAVSource::update(obs_data_t *settings)
 
         // repurpose m_fft_size for meter buffer size
         m_fft_size = size_t(m_audio_info.samples_per_sec * (m_meter_ms / 1000.0)) & -16;
-
-        memset(m_meter_pos, 0, sizeof(m_meter_pos));
-        for(auto& i : m_meter_buf)
-            i = DB_MIN;
-        for(auto& i : m_meter_val)
-            i = DB_MIN;
     }
 
+    // the recursive filter doesn't match the direct one at small radii, which are cheap to filter directly anyway
+    if((m_filter_mode == FilterMode::RECURSIVE_GAUSS) && (m_filter_radius < RECURSIVE_GAUSS_MIN_SIGMA))
+        m_filter_mode = FilterMode::GAUSS;
+
     // calculate FFT size based on video FPS
     obs_video_info vinfo = {};
     if(obs_get_video_info(&vinfo))
@@ -728,238 +908,596 @@ void WAVSource::update(obs_data_t *settings)
             m_fft_size = 128;
     }
 
-    // alloc fftw buffers
     m_output_channels = ((m_capture_channels > 1) || m_stereo) ? 2u : 1u;
-    for(auto i = 0u; i < m_output_channels; ++i)
+
+    if(m_meter_mode)
+        m_num_bars = m_capture_channels; // emulate 1-2 bar spectrum graph
+    else if(m_display_mode != DisplayMode::CURVE)
     {
-        auto count = m_meter_mode ? m_fft_size : m_fft_size / 2;
-        m_decibels[i].reset(avx_alloc<float>(count));
-        if(m_meter_mode)
-            memset(m_decibels[i].get(), 0, count * sizeof(float));
-        else
+        const auto bar_stride = m_bar_width + m_bar_gap;
+        m_num_bars = (int)(m_width / bar_stride);
+        if(((int)m_width - (m_num_bars * bar_stride)) >= m_bar_width)
+            ++m_num_bars;
+    }
+
+    // rounded caps
+    if(m_rounded_caps)
+    {
+        // caps are full circles to avoid distortion issues in radial mode
+        m_cap_radius = (float)m_bar_width / 2.0f;
+        m_cap_tris = std::max((int)((2 * (float)M_PI * m_cap_radius) / 3.0f), 4);
+        if(m_cap_tris & 1) // force even number of triangles
+            m_cap_tris += 1;
+    }
+
+    // vertex count, the buffer itself is (re)created on the graphics thread
+    m_max_steps = 0;
+    if(m_display_mode == DisplayMode::CURVE)
+        m_num_verts = (m_render_mode == RenderMode::LINE) ? m_width : (m_width + 2);
+    else
+    {
+        m_num_verts = (size_t)(m_num_bars * 6);
+        if((m_display_mode == DisplayMode::STEPPED_BAR) || (m_display_mode == DisplayMode::STEPPED_METER))
         {
-            if(m_tsmoothing != TSmoothingMode::NONE)
-                m_tsmooth_buf[i].reset(avx_alloc<float>(count));
-            for(auto j = 0u; j < count; ++j)
-            {
-                m_decibels[i][j] = DB_MIN;
-                if(m_tsmoothing != TSmoothingMode::NONE)
-                    m_tsmooth_buf[i][j] = 0;
-            }
+            const auto step_stride = m_step_width + m_step_gap;
+            const auto cpos = m_stereo ? ((float)m_height / 2 + 0.5f) : ((float)m_height + 0.5f);
+            m_max_steps = (size_t)((cpos - (m_channel_spacing * 0.5f)) / step_stride);
+            if(((int)cpos - (int)(m_max_steps * step_stride) - (int)(m_channel_spacing * 0.5f)) >= m_step_width)
+                ++m_max_steps;
+            m_num_verts *= m_max_steps;
         }
+        else if(m_rounded_caps)
+            m_num_verts += m_cap_tris * ((m_channel_spacing > 0) ? 12 : 6) * m_num_bars; // 2 caps per bar (middle omitted when 0 spacing)
     }
-    if(!m_meter_mode)
+}
+
+std::unique_ptr<PendingConfig> WAVSource::build_config(const SourceSettings& settings)
+{
+    auto config = std::make_shared<PipelineConfig>();
+    config->settings = settings;
+    const auto& s = config->settings;
+
+    // only rebuild what the changed settings invalidate, everything else is shared with the last config
+    const auto old = m_latest.get();
+    const auto& o = (old != nullptr) ? old->settings : s;
+    const auto new_bufs = (old == nullptr) || (s.m_fft_size != o.m_fft_size) || (s.m_meter_mode != o.m_meter_mode)
+        || (s.m_output_channels != o.m_output_channels) || (s.m_tsmoothing != o.m_tsmoothing) || (s.m_energy_bars != o.m_energy_bars)
+        || (s.m_power_domain != o.m_power_domain);
+    const auto new_interp = new_bufs || (s.m_audio_info.samples_per_sec != o.m_audio_info.samples_per_sec)
+        || (s.m_display_mode != o.m_display_mode) || (s.m_interp_mode != o.m_interp_mode) || (s.m_width != o.m_width)
+        || (s.m_num_bars != o.m_num_bars) || (s.m_cutoff_low != o.m_cutoff_low) || (s.m_cutoff_high != o.m_cutoff_high)
+        || (s.m_log_scale != o.m_log_scale);
+    const auto new_filter = new_interp || (s.m_filter_mode != o.m_filter_mode) || (s.m_filter_radius != o.m_filter_radius);
+    const auto new_slope = new_bufs || (s.m_slope != o.m_slope);
+    const auto new_caps = (old == nullptr) || (s.m_rounded_caps != o.m_rounded_caps) || (s.m_cap_tris != o.m_cap_tris)
+        || (s.m_cap_radius != o.m_cap_radius);
+
+    // precomupte interpolated indices
+    config->interp = new_interp ? make_interp_layout(s) : old->interp;
+
+    // audio capture and FFT
+    // the old engine is kept alive until the new one is acquired, so unchanged inputs keep their capture
+    AnalysisEngine::Key key;
+    key.audio_source = s.m_audio_source_name;
+    key.sample_rate = s.m_audio_info.samples_per_sec;
+    key.channels = s.m_capture_channels;
+    key.fft_size = s.m_meter_mode ? 0 : s.m_fft_size;
+    key.window = s.m_window_func;
+    key.simd = m_simd;
+    key.power = !s.m_meter_mode && s.m_power_domain;
+    if(!s.m_meter_mode && s.m_silence_gate)
+        key.gate = std::pow(10.0f, (float)s.m_gate_level / 20.0f);
+    if(!s.m_meter_mode && s.m_decimate)
+    {
+        // downsampling by D and transforming N/D samples gives the same bins below the new nyquist frequency
+        // halve the rate for as long as every displayed bin stays inside the decimator's passband
+        // and the shorter transform is still a multiple of 16 and no smaller than the smallest FFT size
+        constexpr uint32_t max_decimation = 8;
+        while((key.decimation < max_decimation) && ((key.fft_size & 31) == 0) && ((key.fft_size / 2) >= 128)
+            && (config->interp->bin_runs.empty() || (config->interp->bin_runs.back().second <= (size_t)((float)(key.fft_size / 4) * Decimator::PASSBAND))))
+        {
+            key.decimation *= 2;
+            key.fft_size /= 2;
+        }
+    }
+    if(!s.m_meter_mode && (s.m_hop_divisor > 0))
+    {
+        // FFT sizes are multiples of 16, keep hops aligned as well
+        key.hop_size = std::max<size_t>((key.fft_size / s.m_hop_divisor) & -16, 16);
+        key.combine = s.m_hop_combine;
+    }
+    if((old != nullptr) && (old->engine->key() == key))
+        config->engine = old->engine;
+    else
+        config->engine = AnalysisEngine::acquire(key);
+
+    // filter
+    if(new_filter)
     {
-        m_fft_input.reset(avx_alloc<float>(m_fft_size));
-        m_fft_output.reset(avx_alloc<fftwf_complex>(m_fft_size));
-        m_fft_plan = fftwf_plan_dft_r2c_1d((int)m_fft_size, m_fft_input.get(), m_fft_output.get(), FFTW_ESTIMATE);
+        auto filter = std::make_shared<FilterKernels>();
+        if(s.m_filter_mode == FilterMode::GAUSS)
+            filter->kernel = make_gauss_kernel(s.m_filter_radius);
+        else if(s.m_filter_mode == FilterMode::RECURSIVE_GAUSS)
+            filter->recursive_gauss = make_recursive_gauss(s.m_filter_radius, (s.m_display_mode == DisplayMode::CURVE) ? s.m_width : s.m_num_bars);
+        config->filter = std::move(filter);
     }
+    else
+        config->filter = old->filter;
 
-    // window function
-    if(m_window_func != FFTWindow::NONE)
+    // slope
+    if(new_slope)
     {
-        // precompute window coefficients
-        m_window_coefficients.reset(avx_alloc<float>(m_fft_size));
-        const auto N = m_fft_size - 1;
-        constexpr auto pi2 = 2 * (float)M_PI;
-        constexpr auto pi4 = 4 * (float)M_PI;
-        constexpr auto pi6 = 6 * (float)M_PI;
-        switch(m_window_func)
+        const auto num_mods = s.m_fft_size / 2;
+        const auto maxmod = (float)(num_mods - 1);
+        std::shared_ptr<float[]> slope_modifiers(avx_alloc<float>(num_mods), AVXDeleter());
+        for(size_t i = 0; i < num_mods; ++i)
         {
-        case FFTWindow::HAMMING:
-            for(size_t i = 0; i < m_fft_size; ++i)
-                m_window_coefficients[i] = 0.53836f - (0.46164f * std::cos((pi2 * i) / N));
-            break;
-
-        case FFTWindow::BLACKMAN:
-            for(size_t i = 0; i < m_fft_size; ++i)
-                m_window_coefficients[i] = 0.42f - (0.5f * std::cos((pi2 * i) / N)) + (0.08f * std::cos((pi4 * i) / N));
-            break;
-
-        case FFTWindow::BLACKMAN_HARRIS:
-            for(size_t i = 0; i < m_fft_size; ++i)
-                m_window_coefficients[i] = 0.35875f - (0.48829f * std::cos((pi2 * i) / N)) + (0.14128f * std::cos((pi4 * i) / N)) - (0.01168f * std::cos((pi6 * i) / N));
-            break;
-
-        case FFTWindow::HANN:
-        default:
-            for(size_t i = 0; i < m_fft_size; ++i)
-                m_window_coefficients[i] = 0.5f * (1 - std::cos((pi2 * i) / N));
-            break;
+            const auto mod = log10(log_interp(10.0f, 10000.0f, ((float)i * s.m_slope) / maxmod));
+            slope_modifiers[i] = s.m_power_domain ? mod * mod : mod; // same boost in dB
         }
+        config->slope_modifiers = std::move(slope_modifiers);
     }
+    else
+        config->slope_modifiers = old->slope_modifiers;
 
-    m_last_silent = false;
-    m_show = true;
-    m_retries = 0;
-    m_next_retry = 0.0f;
+    // rounded caps
+    if(new_caps)
+    {
+        auto cap_verts = std::make_shared<std::vector<vec2>>();
+        if(s.m_rounded_caps)
+        {
+            auto angle = (2 * (float)M_PI) / (float)s.m_cap_tris;
+            auto verts = s.m_cap_tris + 1;
+            cap_verts->resize(verts);
+            for(auto j = 0; j < verts; ++j)
+            {
+                auto a = j * angle;
+                (*cap_verts)[j].x = s.m_cap_radius * std::cos(a);
+                (*cap_verts)[j].y = s.m_cap_radius * std::sin(a);
+            }
+        }
+        config->cap_verts = std::move(cap_verts);
+    }
+    else
+        config->cap_verts = old->cap_verts;
+
+    auto pending = std::make_unique<PendingConfig>();
+    pending->config = config;
+
+    // alloc output buffers
+    if(new_bufs)
+    {
+        auto bufs = std::make_unique<PipelineBuffers>();
+        for(auto i = 0u; i < s.m_output_channels; ++i)
+        {
+            if(s.m_meter_mode)
+            {
+                bufs->meter_window[i].reset(s.m_fft_size);
+                continue;
+            }
+            auto count = s.m_fft_size / 2;
+            bufs->decibels[i].reset(avx_alloc<float>(count));
+            if(s.m_tsmoothing != TSmoothingMode::NONE)
+                bufs->tsmooth_buf[i].reset(avx_alloc<float>(count));
+            for(auto j = 0u; j < count; ++j)
+            {
+                bufs->decibels[i][j] = s.m_energy_bars ? 0.0f : DB_MIN;
+                if(s.m_tsmoothing != TSmoothingMode::NONE)
+                    bufs->tsmooth_buf[i][j] = 0;
+            }
+        }
+        pending->buffers = std::move(bufs);
+    }
+
+    m_latest = std::move(config);
+    return pending;
+}
 
-    recapture_audio();
-    for(auto& i : m_capturebufs)
+void WAVSource::build_async(const SourceSettings& settings)
+{
+    auto pending = build_config(settings);
+
+    // a config that was never swapped in is superseded by this one
+    // which was built against it, so its buffers still fit if this one didn't need new ones
+    std::unique_ptr<PendingConfig> superseded(m_pending.exchange(nullptr));
+    if((superseded != nullptr) && (pending->buffers == nullptr))
+        pending->buffers = std::move(superseded->buffers);
+    delete m_pending.exchange(pending.release());
+}
+
+void WAVSource::apply_config(PendingConfig& pending)
+{
+    AnalysisWorker::get().remove(this); // tick() can't queue more work while we hold m_mtx
+    std::lock_guard analysis_lock(m_analysis_mtx);
+    end_decay();    // with the settings it was counted for
+
+    const auto& config = *pending.config;
+    const auto& s = config.settings;
+    const auto new_range = (m_interp == nullptr) || (config.interp->bin_runs != m_interp->bin_runs);
+    const auto new_frames = (m_engine == nullptr) || (pending.buffers != nullptr) || (s.m_stereo != m_stereo)
+        || (s.m_async_analysis != m_async_analysis) || new_range;
+    const auto new_pipeline = (pending.buffers != nullptr) || (config.engine != m_engine) || (config.interp != m_interp)
+        || (config.filter != m_filter);
+
+    // the old buffers and tables go out with the pending config, or when the last config sharing them is released
+    static_cast<SourceSettings&>(*this) = s;
+    if(pending.buffers != nullptr)
     {
-        auto bufsz = m_fft_size * sizeof(float);
-        if(i.size < bufsz)
-            circlebuf_push_back_zero(&i, bufsz - i.size);
+        auto& bufs = *pending.buffers;
+        for(auto i = 0; i < 2; ++i)
+        {
+            std::swap(m_decibels[i], bufs.decibels[i]);
+            std::swap(m_tsmooth_buf[i], bufs.tsmooth_buf[i]);
+            std::swap(m_meter_window[i], bufs.meter_window[i]);
+        }
+        for(auto& i : m_meter_buf)
+            i = DB_MIN;
+        for(auto& i : m_meter_val)
+            i = DB_MIN;
+    }
+    else if(new_range && !s.m_meter_mode)
+    {
+        // bins outside the old runs stopped updating when they were last displayed
+        const auto len = s.m_fft_size / 2;
+        for(auto i = 0u; i < s.m_output_channels; ++i)
+        {
+            size_t j = 0;
+            const auto reset_until = [&](size_t stop) {
+                for(; j < stop; ++j)
+                {
+                    m_decibels[i][j] = empty_bin();
+                    if(m_tsmooth_buf[i] != nullptr)
+                        m_tsmooth_buf[i][j] = 0;
+                }
+            };
+            for(const auto& [begin, end] : m_interp->bin_runs)
+            {
+                reset_until(begin);
+                j = end;
+            }
+            reset_until(len);
+        }
     }
 
-    // precomupte interpolated indices
-    if(m_display_mode == DisplayMode::CURVE)
+    if(config.engine != m_engine)
     {
-        init_interp(m_width);
-        for(auto& i : m_interp_bufs)
-            i.resize(m_width);
+        // tearing down an engine destroys its FFT plan, which can wait on the planner
+        ConfigBuilder::get().retire(std::move(m_engine));
+        m_engine = config.engine;
+        std::lock_guard engine_lock(m_engine->mutex());
+        m_meter_read = m_engine->history_total();
     }
-    else if(m_meter_mode)
+    m_interp = config.interp;
+    m_filter = config.filter;
+    m_slope_modifiers = config.slope_modifiers;
+    m_cap_verts = config.cap_verts;
+    m_spectrum_kernel = m_spectrum_kernels[spectrum_kernel_index(m_slope > 0.0f, m_tsmoothing == TSmoothingMode::EXPONENTIAL, m_fast_peaks)];
+
+    // scratch buffers
+    if(m_meter_mode)
     {
         // channel meter rendering through the bar renderer
-        // emulate 1-2 bar spectrum graph
-        m_interp_indices.clear();
-        for(auto& i : m_interp_bufs)
-            i.clear();
         m_interp_bufs[0].resize(m_capture_channels);
-        m_num_bars = m_capture_channels;
+        m_interp_bufs[1].clear();
     }
     else
     {
-        const auto bar_stride = m_bar_width + m_bar_gap;
-        m_num_bars = (int)(m_width / bar_stride);
-        if(((int)m_width - (m_num_bars * bar_stride)) >= m_bar_width)
-            ++m_num_bars;
-        init_interp(m_num_bars + 1); // make extra band for last bar
         for(auto& i : m_interp_bufs)
-            i.resize(m_num_bars);
+            i.resize((m_display_mode == DisplayMode::CURVE) ? m_width : m_num_bars);
     }
+    m_filter_buf.resize((m_filter_mode == FilterMode::GAUSS) ? m_interp_bufs[0].size() : 0);
 
-    // filter
-    if(m_filter_mode == FilterMode::GAUSS)
-        m_kernel = make_gauss_kernel(m_filter_radius);
+    // recompute the silent state with the new floor, gravity, slope and layout, like any other settings change
+    m_show = true;
+    m_last_silent = false;
 
-    // slope
-    const auto num_mods = m_fft_size / 2;
-    const auto maxmod = (float)(num_mods - 1);
-    m_slope_modifiers.reset(avx_alloc<float>(num_mods));
-    for(size_t i = 0; i < num_mods; ++i)
-        m_slope_modifiers[i] = log10(log_interp(10.0f, 10000.0f, ((float)i * m_slope) / maxmod));
+    if(new_frames)
+        init_frames();
 
-    // rounded caps
-    m_cap_verts.clear();
-    if(m_rounded_caps)
+    // old timings don't apply to a rebuilt pipeline, appearance changes keep them
+    if(new_pipeline)
+        m_stats.reset();
+}
+
+void WAVSource::init_frames()
+{
+    const auto channels = m_stereo ? 2u : 1u;
+    const auto outsz = m_fft_size / 2;
+    for(auto i = 0u; i < 3; ++i)
     {
-        // caps are full circles to avoid distortion issues in radial mode
-        m_cap_radius = (float)m_bar_width / 2.0f;
-        m_cap_tris = std::max((int)((2 * (float)M_PI * m_cap_radius) / 3.0f), 4);
-        if(m_cap_tris & 1) // force even number of triangles
-            m_cap_tris += 1;
-        auto angle = (2 * (float)M_PI) / (float)m_cap_tris;
-        auto verts = m_cap_tris + 1;
-        m_cap_verts.resize(verts);
-        for(auto j = 0; j < verts; ++j)
+        auto& frame = m_frames[i];
+        for(auto channel = 0u; channel < 2; ++channel)
         {
-            auto a = j * angle;
-            m_cap_verts[j].x = m_cap_radius * std::cos(a);
-            m_cap_verts[j].y = m_cap_radius * std::sin(a);
+            if(m_async_analysis && !m_meter_mode && (channel < channels))
+            {
+                frame.decibels[channel].reset(avx_alloc<float>(outsz));
+                for(size_t j = 0; j < outsz; ++j)
+                    frame.decibels[channel][j] = empty_bin();
+            }
+            else
+                frame.decibels[channel].reset();
         }
+        frame.decay_db = 0.0f;
+        frame.meter_val[0] = frame.meter_val[1] = DB_MIN;
+        frame.silent = false;
     }
+    m_frames.reset();
 }
 
-void WAVSource::tick(float seconds)
+void WAVSource::analyze(float seconds)
 {
-    std::lock_guard lock(m_mtx);
     if(m_meter_mode)
         tick_meter(seconds);
     else
         tick_spectrum(seconds);
 }
 
-void WAVSource::render([[maybe_unused]] gs_effect_t *effect)
+// while every channel is silent the kernels only scale each smoothed bin by the same factor every frame
+// so the spectrum falls by 20 * log10(gravity) dB per frame (in either domain, gravity is squared for power)
+// instead of rewriting the buffers each frame the fade is counted and added after interpolation, and whether it is
+// below the floor yet follows from the loudest bin at the start
+// returns false if tick_spectrum() has to process the bins, after applying any fade so far to the buffers
+bool WAVSource::decay_silence()
+{
+    auto silent = (m_tsmooth_buf[0] != nullptr) && (m_gravity > 0.0f) && (m_gravity < 1.0f);
+    for(auto channel = 0u; silent && (channel < m_capture_channels); ++channel)
+        silent = m_engine->has_data(channel) && m_engine->silent(channel);
+    if(!silent)
+    {
+        end_decay();
+        return false;
+    }
+    if(m_last_silent)
+        return true;
+
+    if(m_decay_frames == 0)
+    {
+        auto peak = empty_bin();
+        for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
+            for(const auto& [begin, end] : m_interp->bin_runs)
+                peak = std::max(peak, *std::max_element(&m_decibels[channel][begin], &m_decibels[channel][end]));
+        if(m_energy_bars)
+            peak = m_power_domain ? (0.5f * dbfs(peak)) : dbfs(peak);
+        m_decay_peak = peak;
+    }
+
+    // the same test as the per bin silence check, before this frame's decay
+    if(m_decay_peak + m_decay_db < (float)(m_floor - 10))
+    {
+        m_last_silent = true;
+        return true;
+    }
+    ++m_decay_frames;
+    m_decay_db = (float)m_decay_frames * 20.0f * std::log10(m_gravity);
+    return true;
+}
+
+void WAVSource::end_decay()
+{
+    if(m_decay_frames == 0)
+        return;
+
+    const auto scale = std::pow(spectrum_gravity(), (float)m_decay_frames);
+    for(auto& buf : m_tsmooth_buf)
+        if(buf != nullptr)
+            for(const auto& [begin, end] : m_interp->bin_runs)
+                for(auto i = begin; i < end; ++i)
+                    buf[i] *= scale;
+    for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
+        for(const auto& [begin, end] : m_interp->bin_runs)
+            for(auto i = begin; i < end; ++i)
+                m_decibels[channel][i] = m_energy_bars ? (m_decibels[channel][i] * scale) : (m_decibels[channel][i] + m_decay_db);
+    m_decay_frames = 0;
+    m_decay_db = 0.0f;
+}
+
+void WAVSource::publish_frame()
+{
+    auto& frame = m_frames.back();
+    if(!m_meter_mode)
+    {
+        for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
+            for(const auto& [begin, end] : m_interp->bin_runs)
+                memcpy(&frame.decibels[channel][begin], &m_decibels[channel][begin], (end - begin) * sizeof(float));
+    }
+    frame.decay_db = m_decay_db;
+    frame.meter_val[0] = m_meter_val[0];
+    frame.meter_val[1] = m_meter_val[1];
+    frame.silent = m_last_silent;
+    m_frames.publish();
+}
+
+void WAVSource::analyze_async(float seconds)
+{
+    std::lock_guard lock(m_analysis_mtx);
+    if(!m_async_analysis)
+        return;
+    analyze(seconds);
+    publish_frame();
+}
+
+void WAVSource::tick(float seconds)
 {
     std::lock_guard lock(m_mtx);
-    if(m_last_silent && m_hide_on_silent)
+    std::unique_ptr<PendingConfig> pending(m_pending.exchange(nullptr));
+    if(pending != nullptr)
+        apply_config(*pending);
+
+    if(m_stats_interval > 0)
+    {
+        m_stats_elapsed += seconds;
+        if(m_stats_elapsed >= (float)m_stats_interval)
+        {
+            m_stats_elapsed = 0.0f;
+            blog(LOG_INFO, "[" MODULE_NAME "]: \"%s\" stage times p50/p99/max (us): %s", (m_source != nullptr) ? obs_source_get_name(m_source) : "",
+                 m_stats.to_string().c_str());
+        }
+    }
+
+    if(m_async_analysis)
+    {
+        AnalysisWorker::get().enqueue(this, seconds);
         return;
-    if(m_display_mode == DisplayMode::CURVE)
-        render_curve(effect);
-    else
-        render_bars(effect);
+    }
+    std::lock_guard analysis_lock(m_analysis_mtx);
+    analyze(seconds);
 }
 
-void WAVSource::render_curve([[maybe_unused]] gs_effect_t *effect)
+// shared by all sources, loaded on first render and released in obs_module_unload()
+static GradientEffect gradient_effect;
+static bool gradient_effect_failed = false;
+
+const GradientEffect *WAVSource::get_effect()
 {
-    //std::lock_guard lock(m_mtx); // now locked in render()
-    //if(m_last_silent)
-    //    return;
+    if(gradient_effect.effect != nullptr)
+        return &gradient_effect;
+    if(gradient_effect_failed)
+        return nullptr;
+
+    auto filename = obs_module_file("gradient.effect");
+    auto effect = gs_effect_create_from_file(filename, nullptr);
+    bfree(filename);
+    if(effect == nullptr)
+    {
+        blog(LOG_WARNING, "[" MODULE_NAME "]: Failed to load gradient.effect");
+        gradient_effect_failed = true;
+        return nullptr;
+    }
+
+    auto& fx = gradient_effect;
+    fx.effect = effect;
+    fx.solid = gs_effect_get_technique(effect, "Solid");
+    fx.gradient = gs_effect_get_technique(effect, "Gradient");
+    fx.radial = gs_effect_get_technique(effect, "Radial");
+    fx.radial_gradient = gs_effect_get_technique(effect, "RadialGradient");
+    fx.grad_center = gs_effect_get_param_by_name(effect, "grad_center");
+    fx.grad_offset = gs_effect_get_param_by_name(effect, "grad_offset");
+    fx.grad_height = gs_effect_get_param_by_name(effect, "grad_height");
+    fx.color_base = gs_effect_get_param_by_name(effect, "color_base");
+    fx.color_crest = gs_effect_get_param_by_name(effect, "color_crest");
+    fx.graph_width = gs_effect_get_param_by_name(effect, "graph_width");
+    fx.graph_height = gs_effect_get_param_by_name(effect, "graph_height");
+    fx.graph_deadzone = gs_effect_get_param_by_name(effect, "graph_deadzone");
+    fx.graph_invert = gs_effect_get_param_by_name(effect, "graph_invert");
+    fx.radial_center = gs_effect_get_param_by_name(effect, "radial_center");
+    return &fx;
+}
+
+void WAVSource::free_effect()
+{
+    if(gradient_effect.effect != nullptr)
+        gs_effect_destroy(gradient_effect.effect);
+    gradient_effect = {};
+    gradient_effect_failed = false;
+}
+
+gs_technique_t *WAVSource::get_technique(const GradientEffect *fx)
+{
+    if(m_radial)
+        return (m_render_mode == RenderMode::GRADIENT) ? fx->radial_gradient : fx->radial;
+    return (m_render_mode == RenderMode::GRADIENT) ? fx->gradient : fx->solid;
+}
+
+void WAVSource::set_effect_params(const GradientEffect *fx, float cpos)
+{
+    gs_effect_set_float(fx->grad_center, cpos);
+    gs_effect_set_float(fx->grad_offset, m_channel_spacing * 0.5f);
+    gs_effect_set_vec4(fx->color_base, &m_color_base);
+    gs_effect_set_vec4(fx->color_crest, &m_color_crest);
+
+    if(m_radial)
+    {
+        gs_effect_set_float(fx->graph_width, (float)m_width);
+        gs_effect_set_float(fx->graph_height, (float)m_height);
+        gs_effect_set_float(fx->graph_deadzone, m_deadzone);
+        gs_effect_set_bool(fx->graph_invert, m_invert);
+        vec2 rc;
+        vec2_set(&rc, (float)m_height + m_deadzone, (float)m_height + m_deadzone);
+        gs_effect_set_vec2(fx->radial_center, &rc);
+    }
+}
+
+// the vertex buffer is only recreated when update() changes the vertex count
+bool WAVSource::prepare_vertexbuffer()
+{
+    if((m_vbuf != nullptr) && (m_vbuf_verts == m_num_verts))
+        return true;
+
+    if(m_vbuf != nullptr)
+        gs_vertexbuffer_destroy(m_vbuf);
+    m_vbuf = nullptr;
+    m_vbuf_verts = 0;
+    if(m_num_verts == 0)
+        return false;
 
-    // vertex buffer
-    const auto num_verts = (size_t)((m_render_mode == RenderMode::LINE) ? m_width : (m_width + 2));
     auto vbdata = gs_vbdata_create();
-    vbdata->num = num_verts;
-    vbdata->points = (vec3*)bmalloc(num_verts * sizeof(vec3));
+    vbdata->num = m_num_verts;
+    vbdata->points = (vec3*)bmalloc(m_num_verts * sizeof(vec3));
     vbdata->num_tex = 1;
     vbdata->tvarray = (gs_tvertarray*)bzalloc(sizeof(gs_tvertarray));
     vbdata->tvarray->width = 2;
-    vbdata->tvarray->array = bmalloc(2 * num_verts * sizeof(float));
-    auto vbuf = gs_vertexbuffer_create(vbdata, GS_DYNAMIC);
+    vbdata->tvarray->array = bmalloc(2 * m_num_verts * sizeof(float));
+    m_vbuf = gs_vertexbuffer_create(vbdata, GS_DYNAMIC);
+    if(m_vbuf != nullptr)
+        m_vbuf_verts = m_num_verts;
+    return m_vbuf != nullptr;
+}
 
-    auto filename = obs_module_file("gradient.effect");
-    auto shader = gs_effect_create_from_file(filename, nullptr);
-    bfree(filename);
+void WAVSource::render([[maybe_unused]] gs_effect_t *effect)
+{
+    std::lock_guard lock(m_mtx);
 
-    const char *techname;
-    if(m_radial)
-        techname = (m_render_mode == RenderMode::GRADIENT) ? "RadialGradient" : "Radial";
+    // in async mode read the latest finished frame instead of the working buffers
+    const float *decibels[2] = { m_decibels[0].get(), m_decibels[1].get() };
+    const float *meter_val = m_meter_val;
+    auto decay_db = m_decay_db;
+    auto silent = m_last_silent;
+    if(m_async_analysis)
+    {
+        m_frames.update();
+        const auto& frame = m_frames.front();
+        decibels[0] = frame.decibels[0].get();
+        decibels[1] = frame.decibels[1].get();
+        decay_db = frame.decay_db;
+        meter_val = frame.meter_val;
+        silent = frame.silent;
+    }
+
+    if(silent && m_hide_on_silent)
+        return;
+    StageClock clock(m_stats);
+    if(m_display_mode == DisplayMode::CURVE)
+        render_curve(effect, decibels, decay_db, clock);
     else
-        techname = (m_render_mode == RenderMode::GRADIENT) ? "Gradient" : "Solid";
-    auto tech = gs_effect_get_technique(shader, techname);
-    
+        render_bars(effect, decibels, decay_db, meter_val, clock);
+}
+
+void WAVSource::render_curve([[maybe_unused]] gs_effect_t *effect, const float *const *decibels, float decay_db, StageClock& clock)
+{
+    //std::lock_guard lock(m_mtx); // now locked in render()
+    //if(m_last_silent)
+    //    return;
+
+    auto fx = get_effect();
+    if((fx == nullptr) || !prepare_vertexbuffer())
+        return;
+    auto tech = get_technique(fx);
+
     const auto center = (float)m_height / 2 + 0.5f;
     const auto right = (float)m_width + 0.5f;
     const auto bottom = (float)m_height + 0.5f;
     const auto dbrange = m_ceiling - m_floor;
     const auto cpos = m_stereo ? center : bottom;
 
-    auto grad_center = gs_effect_get_param_by_name(shader, "grad_center");
-    gs_effect_set_float(grad_center, cpos);
-    auto grad_offset = gs_effect_get_param_by_name(shader, "grad_offset");
-    gs_effect_set_float(grad_offset, m_channel_spacing * 0.5f);
-    auto color_base = gs_effect_get_param_by_name(shader, "color_base");
-    gs_effect_set_vec4(color_base, &m_color_base);
-    auto color_crest = gs_effect_get_param_by_name(shader, "color_crest");
-    gs_effect_set_vec4(color_crest, &m_color_crest);
-
-    if(m_radial)
-    {
-        auto graph_width = gs_effect_get_param_by_name(shader, "graph_width");
-        gs_effect_set_float(graph_width, (float)m_width);
-        auto graph_height = gs_effect_get_param_by_name(shader, "graph_height");
-        gs_effect_set_float(graph_height, (float)m_height);
-        auto graph_deadzone = gs_effect_get_param_by_name(shader, "graph_deadzone");
-        gs_effect_set_float(graph_deadzone, m_deadzone);
-        auto graph_invert = gs_effect_get_param_by_name(shader, "graph_invert");
-        gs_effect_set_bool(graph_invert, m_invert);
-        auto radial_center = gs_effect_get_param_by_name(shader, "radial_center");
-        vec2 rc;
-        vec2_set(&rc, (float)m_height + m_deadzone, (float)m_height + m_deadzone);
-        gs_effect_set_vec2(radial_center, &rc);
-    }
+    set_effect_params(fx, cpos);
 
     // interpolation
     auto miny = cpos;
     for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
     {
-        if(m_interp_mode == InterpMode::LANCZOS)
-            for(auto i = 0u; i < m_width; ++i)
-                m_interp_bufs[channel][i] = lanczos_interp(m_interp_indices[i], 3.0f, m_fft_size / 2, m_decibels[channel].get());
-        else
-            for(auto i = 0u; i < m_width; ++i)
-                m_interp_bufs[channel][i] = m_decibels[channel][(int)m_interp_indices[i]];
+        interp_channel(channel, decibels[channel], decay_db, clock);
 
-        if(m_filter_mode != FilterMode::NONE)
-        {
-            if(HAVE_AVX)
-                m_interp_bufs[channel] = apply_filter_fma3(m_interp_bufs[channel], m_kernel);
-            else
-                m_interp_bufs[channel] = apply_filter(m_interp_bufs[channel], m_kernel);
-        }
-        
+        clock.begin(Stage::VERTICES);
         const auto step = (m_render_mode == RenderMode::LINE) ? 1 : 2;
         for(auto i = 0u; i < m_width; i += step)
         {
@@ -969,22 +1507,23 @@ void WAVSource::render_curve([[maybe_unused]] gs_effect_t *effect)
             m_interp_bufs[channel][i] = val;
         }
     }
-    auto grad_height = gs_effect_get_param_by_name(shader, "grad_height");
-    gs_effect_set_float(grad_height, (cpos - miny - (m_channel_spacing * 0.5f)) * m_grad_ratio);
+    clock.begin(Stage::DRAW);
+    gs_effect_set_float(fx->grad_height, (cpos - miny - (m_channel_spacing * 0.5f)) * m_grad_ratio);
 
     gs_technique_begin(tech);
     gs_technique_begin_pass(tech, 0);
-    gs_load_vertexbuffer(vbuf);
+    gs_load_vertexbuffer(m_vbuf);
     gs_load_indexbuffer(nullptr);
 
     for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
     {
+        clock.begin(Stage::VERTICES);
         auto vertpos = 0u;
         auto offset = m_channel_spacing * 0.5f;
         if(channel)
             offset = -offset;
         auto bot = cpos - offset;
-        vbdata = gs_vertexbuffer_get_data(vbuf);
+        auto vbdata = gs_vertexbuffer_get_data(m_vbuf);
         if(m_render_mode != RenderMode::LINE)
             vec3_set(&vbdata->points[vertpos++], -0.5, bot, 0);
 
@@ -1006,36 +1545,28 @@ void WAVSource::render_curve([[maybe_unused]] gs_effect_t *effect)
         if(m_render_mode != RenderMode::LINE)
             vec3_set(&vbdata->points[vertpos++], right, bot, 0);
 
-        gs_vertexbuffer_flush(vbuf);
+        clock.begin(Stage::DRAW);
+        gs_vertexbuffer_flush(m_vbuf);
 
-        gs_draw((m_render_mode != RenderMode::LINE) ? GS_TRISTRIP : GS_LINESTRIP, 0, (uint32_t)num_verts);
+        gs_draw((m_render_mode != RenderMode::LINE) ? GS_TRISTRIP : GS_LINESTRIP, 0, (uint32_t)m_num_verts);
     }
 
     gs_load_vertexbuffer(nullptr);
-    gs_vertexbuffer_destroy(vbuf);
     gs_technique_end_pass(tech);
     gs_technique_end(tech);
-
-    gs_effect_destroy(shader);
 }
 
 // FIXME: DESPERATELY needs cleanup
-void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
+void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect, const float *const *decibels, float decay_db, const float *meter_val, StageClock& clock)
 {
     //std::lock_guard lock(m_mtx); // now locked in render()
     //if(m_last_silent)
     //    return;
 
-    auto filename = obs_module_file("gradient.effect");
-    auto shader = gs_effect_create_from_file(filename, nullptr);
-    bfree(filename);
-
-    const char *techname;
-    if(m_radial)
-        techname = (m_render_mode == RenderMode::GRADIENT) ? "RadialGradient" : "Radial";
-    else
-        techname = (m_render_mode == RenderMode::GRADIENT) ? "Gradient" : "Solid";
-    auto tech = gs_effect_get_technique(shader, techname);
+    auto fx = get_effect();
+    if((fx == nullptr) || !prepare_vertexbuffer())
+        return;
+    auto tech = get_technique(fx);
 
     const auto bar_stride = m_bar_width + m_bar_gap;
     const auto step_stride = m_step_width + m_step_gap;
@@ -1043,50 +1574,9 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
     const auto bottom = (float)m_height + 0.5f;
     const auto dbrange = m_ceiling - m_floor;
     const auto cpos = m_stereo ? center : bottom;
+    const auto& cap_verts = *m_cap_verts;
 
-    auto max_steps = (size_t)((cpos - (m_channel_spacing * 0.5f)) / step_stride);
-    if(((int)cpos - (int)(max_steps * step_stride) - (int)(m_channel_spacing * 0.5f)) >= m_step_width)
-        ++max_steps;
-
-    // vertex buffer
-    auto num_verts = (size_t)(m_num_bars * 6);
-    if((m_display_mode == DisplayMode::STEPPED_BAR) || (m_display_mode == DisplayMode::STEPPED_METER))
-        num_verts *= max_steps;
-    else if(m_rounded_caps)
-        num_verts += m_cap_tris * ((m_channel_spacing > 0) ? 12 : 6) * m_num_bars; // 2 caps per bar (middle omitted when 0 spacing)
-    auto vbdata = gs_vbdata_create();
-    vbdata->num = num_verts;
-    vbdata->points = (vec3*)bmalloc(num_verts * sizeof(vec3));
-    vbdata->num_tex = 1;
-    vbdata->tvarray = (gs_tvertarray*)bzalloc(sizeof(gs_tvertarray));
-    vbdata->tvarray->width = 2;
-    vbdata->tvarray->array = bmalloc(2 * num_verts * sizeof(float));
-    auto vbuf = gs_vertexbuffer_create(vbdata, GS_DYNAMIC);
-
-    auto grad_center = gs_effect_get_param_by_name(shader, "grad_center");
-    gs_effect_set_float(grad_center, cpos);
-    auto grad_offset = gs_effect_get_param_by_name(shader, "grad_offset");
-    gs_effect_set_float(grad_offset, m_channel_spacing * 0.5f);
-    auto color_base = gs_effect_get_param_by_name(shader, "color_base");
-    gs_effect_set_vec4(color_base, &m_color_base);
-    auto color_crest = gs_effect_get_param_by_name(shader, "color_crest");
-    gs_effect_set_vec4(color_crest, &m_color_crest);
-
-    if(m_radial)
-    {
-        auto graph_width = gs_effect_get_param_by_name(shader, "graph_width");
-        gs_effect_set_float(graph_width, (float)m_width);
-        auto graph_height = gs_effect_get_param_by_name(shader, "graph_height");
-        gs_effect_set_float(graph_height, (float)m_height);
-        auto graph_deadzone = gs_effect_get_param_by_name(shader, "graph_deadzone");
-        gs_effect_set_float(graph_deadzone, m_deadzone);
-        auto graph_invert = gs_effect_get_param_by_name(shader, "graph_invert");
-        gs_effect_set_bool(graph_invert, m_invert);
-        auto radial_center = gs_effect_get_param_by_name(shader, "radial_center");
-        vec2 rc;
-        vec2_set(&rc, (float)m_height + m_deadzone, (float)m_height + m_deadzone);
-        gs_effect_set_vec2(radial_center, &rc);
-    }
+    set_effect_params(fx, cpos);
 
     // interpolation
     auto miny = cpos;
@@ -1095,54 +1585,12 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
         if(m_meter_mode)
         {
             for(auto i = 0u; i < m_capture_channels; ++i)
-                m_interp_bufs[0][i] = m_meter_val[i];
+                m_interp_bufs[0][i] = meter_val[i];
         }
         else
-        {
-            if(m_interp_mode == InterpMode::LANCZOS)
-            {
-                for(auto i = 0; i < m_num_bars; ++i)
-                {
-                    auto pos = m_interp_indices[i];
-                    float sum = 0.0f;
-                    int count = 0;
-                    float stop = m_interp_indices[i + 1];
-                    do
-                    {
-                        sum += lanczos_interp(pos, 3.0f, m_fft_size / 2, m_decibels[channel].get());
-                        ++count;
-                        pos += 1.0f;
-                    } while(pos < stop);
-                    m_interp_bufs[channel][i] = sum / (float)count;
-                }
-            }
-            else
-            {
-                for(auto i = 0; i < m_num_bars; ++i)
-                {
-                    auto pos = (int)m_interp_indices[i];
-                    float sum = 0.0f;
-                    int count = 0;
-                    int stop = (int)m_interp_indices[i + 1];
-                    do
-                    {
-                        sum += m_decibels[channel][pos];
-                        ++count;
-                        ++pos;
-                    } while(pos < stop);
-                    m_interp_bufs[channel][i] = sum / (float)count;
-                }
-            }
-
-            if(m_filter_mode != FilterMode::NONE)
-            {
-                if(HAVE_AVX)
-                    m_interp_bufs[channel] = apply_filter_fma3(m_interp_bufs[channel], m_kernel);
-                else
-                    m_interp_bufs[channel] = apply_filter(m_interp_bufs[channel], m_kernel);
-            }
-        }
+            interp_channel(channel, decibels[channel], decay_db, clock);
 
+        clock.begin(Stage::VERTICES);
         auto border_top = (m_rounded_caps) ? m_cap_radius : 0.5f;
         auto border_bottom = (m_rounded_caps && (!m_stereo || (m_channel_spacing > 0))) ? cpos - m_cap_radius : cpos;
         if(m_channel_spacing > 0)
@@ -1155,18 +1603,19 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
             m_interp_bufs[channel][i] = val;
         }
     }
-    auto grad_height = gs_effect_get_param_by_name(shader, "grad_height");
-    gs_effect_set_float(grad_height, (cpos - miny - (m_channel_spacing * 0.5f)) * m_grad_ratio);
+    clock.begin(Stage::DRAW);
+    gs_effect_set_float(fx->grad_height, (cpos - miny - (m_channel_spacing * 0.5f)) * m_grad_ratio);
 
     gs_technique_begin(tech);
     gs_technique_begin_pass(tech, 0);
-    gs_load_vertexbuffer(vbuf);
+    gs_load_vertexbuffer(m_vbuf);
     gs_load_indexbuffer(nullptr);
 
     for(auto channel = 0u; channel < (m_stereo ? 2u : 1u); ++channel)
     {
+        clock.begin(Stage::VERTICES);
         auto vertpos = 0u;
-        vbdata = gs_vertexbuffer_get_data(vbuf);
+        auto vbdata = gs_vertexbuffer_get_data(m_vbuf);
 
         for(auto i = 0; i < m_num_bars; ++i)
         {
@@ -1177,7 +1626,7 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
             if((m_display_mode == DisplayMode::STEPPED_BAR) || (m_display_mode == DisplayMode::STEPPED_METER))
             {
                 auto offset = m_channel_spacing * 0.5f;
-                for(auto j = 0u; j < max_steps; ++j)
+                for(auto j = 0u; j < m_max_steps; ++j)
                 {
                     auto y1 = (float)(j * step_stride);
                     auto y2 = y1 + m_step_width;
@@ -1227,10 +1676,10 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
                     auto stop = m_radial ? m_cap_tris : (start + half);
                     for(auto j = start; j < stop; ++j)
                     {
-                        auto cx1 = m_cap_verts[j].x;
-                        auto cy1 = m_cap_verts[j].y;
-                        auto cx2 = m_cap_verts[j + 1].x;
-                        auto cy2 = m_cap_verts[j + 1].y;
+                        auto cx1 = cap_verts[j].x;
+                        auto cy1 = cap_verts[j].y;
+                        auto cx2 = cap_verts[j + 1].x;
+                        auto cy2 = cap_verts[j + 1].y;
                         vec3_set(&vbdata->points[vertpos], cx1 + ccx, cy1 + val, 0);
                         vec3_set(&vbdata->points[vertpos + 1], cx2 + ccx, cy2 + val, 0);
                         vec3_set(&vbdata->points[vertpos + 2], ccx, val, 0);
@@ -1243,10 +1692,10 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
                         stop = m_radial ? m_cap_tris : (start + half);
                         for(auto j = start; j < stop; ++j)
                         {
-                            auto cx1 = m_cap_verts[j].x;
-                            auto cy1 = m_cap_verts[j].y;
-                            auto cx2 = m_cap_verts[j + 1].x;
-                            auto cy2 = m_cap_verts[j + 1].y;
+                            auto cx1 = cap_verts[j].x;
+                            auto cy1 = cap_verts[j].y;
+                            auto cx2 = cap_verts[j + 1].x;
+                            auto cy2 = cap_verts[j + 1].y;
                             vec3_set(&vbdata->points[vertpos], cx1 + ccx, cy1 + ccy, 0);
                             vec3_set(&vbdata->points[vertpos + 1], cx2 + ccx, cy2 + ccy, 0);
                             vec3_set(&vbdata->points[vertpos + 2], ccx, ccy, 0);
@@ -1257,98 +1706,66 @@ void WAVSource::render_bars([[maybe_unused]] gs_effect_t *effect)
             }
         }
 
-        gs_vertexbuffer_flush(vbuf);
+        clock.begin(Stage::DRAW);
+        gs_vertexbuffer_flush(m_vbuf);
 
         if(vertpos > 0)
             gs_draw(GS_TRIS, 0, vertpos);
     }
 
     gs_load_vertexbuffer(nullptr);
-    gs_vertexbuffer_destroy(vbuf);
     gs_technique_end_pass(tech);
     gs_technique_end(tech);
-
-    gs_effect_destroy(shader);
 }
 
-// WAVSourceAVX and WAVSourceAVX2 both inherit this implementation
-// WAVSourceSSE2 overrides in source_sse2.cpp
-DECORATE_AVX
-void WAVSource::tick_meter(float seconds)
+bool WAVSource::consume_meter_samples(float seconds, StageClock& clock)
 {
-    if(!check_audio_capture(seconds))
-        return;
+    std::lock_guard engine_lock(m_engine->mutex());
+    if(!m_engine->process(obs_get_video_frame_time(), seconds, false, clock))
+        return false;
 
     if(m_capture_channels == 0)
-        return;
+        return false;
 
-    // repurpose m_decibels as circular buffer for sample data
+    clock.begin(Stage::CAPTURE);
+
+    // anything older than the meter window would be overwritten anyway
+    const auto total = m_engine->history_total();
+    const auto count = (size_t)std::min<uint64_t>(total - m_meter_read, m_fft_size);
     for(auto channel = 0u; channel < m_capture_channels; ++channel)
     {
-        while(m_capturebufs[channel].size > 0)
+        auto& window = m_meter_window[channel];
+        auto pos = total - count;
+        auto remaining = count;
+        while(remaining > 0)
         {
-            auto consume = m_capturebufs[channel].size;
-            auto max = (m_fft_size - m_meter_pos[channel]) * sizeof(float);
-            if(consume >= max)
-            {
-                circlebuf_pop_front(&m_capturebufs[channel], &m_decibels[channel][m_meter_pos[channel]], max);
-                m_meter_pos[channel] = 0;
-            }
-            else
-            {
-                circlebuf_pop_front(&m_capturebufs[channel], &m_decibels[channel][m_meter_pos[channel]], consume);
-                m_meter_pos[channel] += consume / sizeof(float);
-            }
+            auto n = std::min(remaining, window.contiguous());
+            m_engine->read_history(channel, pos, n, window.write_ptr());
+            window.commit(n);
+            pos += n;
+            remaining -= n;
         }
     }
+    m_meter_read = total;
+    return true;
+}
+
+// RMS and peak are kept up to date by the meter windows as samples arrive
+void WAVSource::tick_meter(float seconds)
+{
+    StageClock clock(m_stats);
+    if(!consume_meter_samples(seconds, clock))
+        return;
 
     if(!m_show)
         return;
 
+    clock.begin(Stage::METER);
+
     for(auto channel = 0u; channel < m_capture_channels; ++channel)
     {
-        float out = 0.0f;
-        constexpr auto step = (sizeof(__m256) / sizeof(float)) * 2; // buffer size is 64-byte multiple
-        constexpr auto halfstep = step / 2;
-        if(m_meter_rms)
-        {
-            auto sum = _mm256_setzero_ps();
-            for(size_t i = 0; i < m_fft_size; i += step)
-            {
-                auto chunk = _mm256_load_ps(&m_decibels[channel][i]);
-                sum = _mm256_fmadd_ps(chunk, chunk, sum);
-                chunk = _mm256_load_ps(&m_decibels[channel][i + halfstep]); // unroll loop to cache line size
-                sum = _mm256_fmadd_ps(chunk, chunk, sum);
-            }
-
-            auto high = _mm256_extractf128_ps(sum, 1); // split into two 128-bit vecs
-            auto low = _mm_add_ps(high, _mm256_castps256_ps128(sum)); // (h[0] + l[0]) (h[1] + l[1]) (h[2] + l[2]) (h[3] + l[3])
-            high = _mm_permute_ps(low, _MM_SHUFFLE(3, 2, 3, 2)); // high[0] = low[2], high[1] = low[3]
-            low = _mm_add_ps(high, low); // (h[0] + l[0]) (h[1] + l[1])
-            high = _mm_movehdup_ps(low); // high[0] = low[1]
-            out = _mm_cvtss_f32(_mm_add_ss(high, low));
-
-            out = std::sqrt(out / m_fft_size);
-        }
-        else
-        {
-            const auto signbit = _mm256_set1_ps(-0.0f);
-            auto maxvec = _mm256_setzero_ps();
-            for(size_t i = 0; i < m_fft_size; i += step)
-            {
-                auto chunk = _mm256_andnot_ps(signbit, _mm256_load_ps(&m_decibels[channel][i])); // absolute value
-                maxvec = _mm256_max_ps(maxvec, chunk);
-                chunk = _mm256_andnot_ps(signbit, _mm256_load_ps(&m_decibels[channel][i + halfstep])); // unroll loop to cache line size
-                maxvec = _mm256_max_ps(maxvec, chunk);
-            }
-
-            auto high = _mm256_extractf128_ps(maxvec, 1); // split into two 128-bit vecs
-            auto low = _mm_max_ps(high, _mm256_castps256_ps128(maxvec)); // max(h[0], l[0]) max(h[1], l[1]) max(h[2], l[2]) max(h[3], l[3])
-            high = _mm_permute_ps(low, _MM_SHUFFLE(3, 2, 3, 2)); // high[0] = low[2], high[1] = low[3]
-            low = _mm_max_ps(high, low); // max(h[0], l[0]) max(h[1], l[1])
-            high = _mm_movehdup_ps(low); // high[0] = low[1]
-            out = _mm_cvtss_f32(_mm_max_ss(high, low));
-        }
+        const auto& window = m_meter_window[channel];
+        auto out = m_meter_rms ? std::sqrt(window.mean_square()) : window.peak();
 
         const auto g = m_gravity;
         const auto g2 = 1.0f - g;
@@ -1362,6 +1779,45 @@ void WAVSource::tick_meter(float seconds)
     }
 }
 
+unsigned int WAVSource::spectrum_channels()
+{
+    std::lock_guard lock(m_mtx);
+    return m_meter_mode ? 0u : (m_stereo ? 2u : 1u);
+}
+
+size_t WAVSource::spectrum_size(bool raw)
+{
+    std::lock_guard lock(m_mtx);
+    if(m_meter_mode)
+        return 0;
+    return raw ? (m_fft_size / 2) : m_interp_bufs[0].size();
+}
+
+bool WAVSource::read_spectrum(unsigned int channel, float *dst, bool raw)
+{
+    std::lock_guard lock(m_mtx);
+    if(m_meter_mode || m_async_analysis || (channel >= (m_stereo ? 2u : 1u)))
+        return false;
+
+    if(raw && m_energy_bars)
+    {
+        for(size_t i = 0; i < m_fft_size / 2; ++i)
+            dst[i] = (m_power_domain ? (0.5f * dbfs(m_decibels[channel][i])) : dbfs(m_decibels[channel][i])) + m_decay_db;
+    }
+    else if(raw)
+    {
+        for(size_t i = 0; i < m_fft_size / 2; ++i)
+            dst[i] = m_decibels[channel][i] + m_decay_db;
+    }
+    else
+    {
+        StageClock clock(m_stats);
+        interp_channel(channel, m_decibels[channel].get(), m_decay_db, clock);
+        memcpy(dst, m_interp_bufs[channel].data(), m_interp_bufs[channel].size() * sizeof(float));
+    }
+    return true;
+}
+
 void WAVSource::show()
 {
     std::lock_guard lock(m_mtx);
@@ -1413,44 +1869,3 @@ void WAVSource::register_source()
 
     obs_register_source(&info);
 }
-
-void WAVSource::capture_audio([[maybe_unused]] obs_source_t *source, const audio_data *audio, bool muted)
-{
-    if(!m_mtx.try_lock_for(std::chrono::milliseconds(10)))
-        return;
-    std::lock_guard lock(m_mtx, std::adopt_lock);
-    if(m_audio_source == nullptr)
-        return;
-
-    auto sz = size_t(audio->frames * sizeof(float));
-    for(auto i = 0u; i < m_capture_channels; ++i)
-    {
-        if(muted)
-            circlebuf_push_back_zero(&m_capturebufs[i], sz);
-        else
-            circlebuf_push_back(&m_capturebufs[i], audio->data[i], sz);
-
-        auto total = m_capturebufs[i].size;
-        auto max = m_meter_mode ? 8192 : m_fft_size * sizeof(float) * 2;
-        if(total > max)
-            circlebuf_pop_front(&m_capturebufs[i], nullptr, total - max);
-    }
-}
-
-void WAVSource::capture_output_bus([[maybe_unused]] size_t mix_idx, const audio_data *audio)
-{
-    if(!m_mtx.try_lock_for(std::chrono::milliseconds(10)))
-        return;
-    std::lock_guard lock(m_mtx, std::adopt_lock);
-
-    auto sz = size_t(audio->frames * sizeof(float));
-    for(auto i = 0u; i < m_capture_channels; ++i)
-    {
-        circlebuf_push_back(&m_capturebufs[i], audio->data[i], sz);
-
-        auto total = m_capturebufs[i].size;
-        auto max = m_meter_mode ? 8192 : m_fft_size * sizeof(float) * 2;
-        if(total > max)
-            circlebuf_pop_front(&m_capturebufs[i], nullptr, total - max);
-    }
-}
@@ -17,13 +17,21 @@
 
 #pragma once
 #include <mutex>
+#include <atomic>
 #include <obs-module.h>
-#include <util/circlebuf.h>
 #include <fftw3.h>
 #include <memory>
+#include <vector>
+#include <string>
+#include <array>
+#include <utility>
 #include "module.hpp"
 #include "aligned_mem.hpp"
 #include "filter.hpp"
+#include "interp_table.hpp"
+#include "triple_buffer.hpp"
+#include "meter_window.hpp"
+#include "stage_stats.hpp"
 
 using AVXBufR = std::unique_ptr<float[], AVXDeleter>;
 using AVXBufC = std::unique_ptr<fftwf_complex[], AVXDeleter>;
@@ -37,6 +45,13 @@ enum class FFTWindow
     BLACKMAN_HARRIS
 };
 
+// how the windows analyzed in one frame are combined
+enum class HopCombine
+{
+    AVERAGE,    // Welch's method, averages power
+    MAX
+};
+
 enum class InterpMode
 {
     POINT,
@@ -46,7 +61,8 @@ enum class InterpMode
 enum class FilterMode
 {
     NONE,
-    GAUSS
+    GAUSS,
+    RECURSIVE_GAUSS
 };
 
 // temporal smoothing
@@ -63,6 +79,15 @@ enum class RenderMode
     GRADIENT
 };
 
+// instruction set of the spectrum kernels, one per WAVSource subclass
+enum class SIMDLevel
+{
+    SCALAR,
+    SSE2,
+    AVX,
+    AVX2
+};
+
 enum class DisplayMode
 {
     CURVE,
@@ -72,40 +97,50 @@ enum class DisplayMode
     STEPPED_METER
 };
 
-class WAVSource
+class AnalysisEngine;
+
+// gradient.effect and its handles, loaded once and shared by all sources
+// only touched from the graphics thread
+struct GradientEffect
 {
-protected:
-    // audio callback (and posssibly others) run in separate thread
-    // obs_source_remove_audio_capture_callback evidently flushes the callback
-    // so mutex must be recursive to avoid deadlock
-    std::recursive_timed_mutex m_mtx;
+    gs_effect_t *effect = nullptr;
+    gs_technique_t *solid = nullptr;
+    gs_technique_t *gradient = nullptr;
+    gs_technique_t *radial = nullptr;
+    gs_technique_t *radial_gradient = nullptr;
+    gs_eparam_t *grad_center = nullptr;
+    gs_eparam_t *grad_offset = nullptr;
+    gs_eparam_t *grad_height = nullptr;
+    gs_eparam_t *color_base = nullptr;
+    gs_eparam_t *color_crest = nullptr;
+    gs_eparam_t *graph_width = nullptr;
+    gs_eparam_t *graph_height = nullptr;
+    gs_eparam_t *graph_deadzone = nullptr;
+    gs_eparam_t *graph_invert = nullptr;
+    gs_eparam_t *radial_center = nullptr;
+};
 
-    // obs sources
-    obs_source_t *m_source = nullptr;               // our source
-    obs_weak_source_t *m_audio_source = nullptr;    // captured audio source
-    std::string m_audio_source_name;
+// finished analysis results handed from the analysis worker to the renderer
+struct SpectrumFrame
+{
+    AVXBufR decibels[2];
+    float decay_db = 0.0f;  // see WAVSource::m_decay_db
+    float meter_val[2] = { 0.0f, 0.0f };
+    bool silent = false;
+};
 
-    // audio capture
+// user settings and the sizes derived from them, see load() and derive()
+// WAVSource holds the active copy, a new one is parsed by update() and built by the ConfigBuilder
+struct SourceSettings
+{
+    std::string m_audio_source_name;
     obs_audio_info m_audio_info{};
-    circlebuf m_capturebufs[2]{};
     uint32_t m_capture_channels = 0;    // audio input channels
     uint32_t m_output_channels = 0;     // fft output channels (*not* display channels)
-    bool m_output_bus_captured = false; // do we have an active audio output callback? (via audio_output_connect())
-
-    // 32-byte aligned buffers for FFT/AVX processing
-    AVXBufR m_fft_input;
-    AVXBufC m_fft_output;
-    fftwf_plan m_fft_plan{};
-    AVXBufR m_window_coefficients;
-    AVXBufR m_tsmooth_buf[2];   // last frames magnitudes
-    AVXBufR m_decibels[2];      // dBFS, or audio sample buffer in meter mode
     size_t m_fft_size = 0;      // number of fft elements, or audio samples in meter mode (not bytes, multiple of 16)
-                                // in meter mode m_fft_size is the size of the circular buffer in samples
+                                // in meter mode m_fft_size is the size of the sample window
 
     // meter mode
-    size_t m_meter_pos[2] = { 0, 0 };       // circular buffer position (per channel)
-    float m_meter_val[2] = { 0.0f, 0.0f };  // dBFS
-    float m_meter_buf[2] = { 0.0f, 0.0f };  // EMA
     bool m_meter_rms = false;               // RMS mode
     bool m_meter_mode = false;              // either meter or stepped meter display mode is selected
     int m_meter_ms = 100;                   // milliseconds of audio data to buffer
@@ -117,19 +152,16 @@ protected:
     unsigned int m_width = 800;
     unsigned int m_height = 225;
 
-    // show video source
-    bool m_show = true;
-
-    // graph was silent last frame
-    bool m_last_silent = false;
-
-    // audio capture retries
-    int m_retries = 0;
-    float m_next_retry = 0.0f;
-
     // settings
     RenderMode m_render_mode = RenderMode::SOLID;
     FFTWindow m_window_func = FFTWindow::HANN;
+    unsigned int m_hop_divisor = 0;     // hop size as a fraction of the FFT size, 0 for none
+    HopCombine m_hop_combine = HopCombine::AVERAGE;
+    bool m_decimate = false;            // low-pass and downsample before the FFT when the cutoffs allow it
+    bool m_power_domain = false;        // the spectrum is squared magnitude (power) from the FFT up to the dB conversion
+    bool m_silence_gate = false;        // audio with peaks below m_gate_level counts as silent
+    int m_gate_level = -90;             // dBFS
+    bool m_energy_bars = false;         // bars sum bin power instead of averaging dB, the spectrum is kept linear
     InterpMode m_interp_mode = InterpMode::LANCZOS;
     FilterMode m_filter_mode = FilterMode::GAUSS;
     TSmoothingMode m_tsmoothing = TSmoothingMode::EXPONENTIAL;
@@ -158,41 +190,177 @@ protected:
     bool m_rounded_caps = false;
     bool m_hide_on_silent = false;
     int m_channel_spacing = 0;
+    bool m_async_analysis = false;  // analyze on the AnalysisWorker instead of in tick()
+    int m_stats_interval = 0;       // seconds between stage time log entries, 0 for never
+    float m_filter_radius = 0.0f;
+
+    // geometry
+    size_t m_num_verts = 0;
+    size_t m_max_steps = 0;         // stepped bars: steps per bar
+    float m_cap_radius = 0.0f;
+    int m_cap_tris = 4;             // number of triangles each cap is composed of (4 min)
+
+    void load(obs_data_t *settings);    // read the user settings
+    void derive();                      // audio format, FFT size, bar and vertex counts, queries OBS
+};
+
+// interpolation positions and lanczos weights
+struct InterpLayout
+{
+    std::vector<float> indices;
+    InterpTable table;                  // curve: lanczos weights for every point
+    BandMatrix bars;                    // bars: bins -> bars, lanczos and averaging (or energy sum) weights combined
+    std::vector<float> weight_sums;     // per point or bar, how much of a dB offset on every bin carries through, empty for all 1
+
+    // [begin, end) runs of bins read by the interpolation, in order and multiples of 8 so the spectrum kernels stay aligned
+    // bins outside of them are never displayed, so nothing past the FFT touches them
+    // usually one run, nearest neighbor curves skip the bins between their sample points
+    std::vector<std::pair<size_t, size_t>> bin_runs;
+};
+
+struct FilterKernels
+{
+    Kernel<float> kernel;
+    RecursiveGauss<float> recursive_gauss;
+};
+
+// everything built from one set of settings, immutable once built
+// parts whose inputs didn't change are shared with the previous config instead of being rebuilt
+struct PipelineConfig
+{
+    SourceSettings settings;
+    std::shared_ptr<AnalysisEngine> engine;
+    std::shared_ptr<const InterpLayout> interp;
+    std::shared_ptr<const FilterKernels> filter;
+    std::shared_ptr<const float[]> slope_modifiers;
+    std::shared_ptr<const std::vector<vec2>> cap_verts;    // pre-rotated cap vertices (to be translated to final pos)
+};
+
+// per source analysis buffers, only built when a config changes their size
+struct PipelineBuffers
+{
+    AVXBufR tsmooth_buf[2];
+    AVXBufR decibels[2];
+    MeterWindow meter_window[2];
+};
+
+// a built config waiting for tick() to swap it in
+struct PendingConfig
+{
+    std::shared_ptr<const PipelineConfig> config;
+    std::unique_ptr<PipelineBuffers> buffers;   // null to keep the current ones
+};
+
+// slope, temporal smoothing and fast peaks over bins [begin, end) of one channel of normalized magnitudes, written to out
+// every ISA instantiates one per combination of those settings, so the per bin loop has no branches
+// slope_modifiers and tsmooth are only read by the variants that need them
+using SpectrumKernel = void (*)(const float *mags, const float *slope_modifiers, float *tsmooth, float *out, size_t begin, size_t end, float gravity);
+using SpectrumKernelTable = std::array<SpectrumKernel, 8>;   // indexed by WAVSource::spectrum_kernel_index()
+
+class WAVSource : protected SourceSettings
+{
+protected:
+    // update/tick/render may run in separate threads
+    std::recursive_mutex m_mtx;
+
+    // guards DSP state while it is being analyzed, possibly on the analysis worker
+    // lock order is m_mtx, m_analysis_mtx, then the engine mutex, render() never takes the latter two
+    std::mutex m_analysis_mtx;
+
+    // obs sources
+    obs_source_t *m_source = nullptr;               // our source
+
+    // configs built by the ConfigBuilder, m_pending is published with an atomic exchange and swapped in by tick()
+    // m_latest is the newest one built, only touched by the builder, new configs share its unchanged parts
+    std::atomic<PendingConfig*> m_pending{ nullptr };
+    std::shared_ptr<const PipelineConfig> m_latest;
+
+    // audio capture and FFT, shared with other sources watching the same input
+    std::shared_ptr<AnalysisEngine> m_engine;
+    const SIMDLevel m_simd;                         // kernels of the subclass, the engine is picked to match
+
+    // spectrum kernels of the subclass, the one matching the settings is picked by apply_config()
+    const SpectrumKernelTable& m_spectrum_kernels;
+    SpectrumKernel m_spectrum_kernel = nullptr;
+
+    // 32-byte aligned buffers for AVX processing
+    AVXBufR m_tsmooth_buf[2];   // last frames magnitudes
+    AVXBufR m_decibels[2];      // dBFS, unused in meter mode
+
+    // meter mode
+    MeterWindow m_meter_window[2];          // last m_fft_size samples (per channel)
+    uint64_t m_meter_read = 0;              // engine sample history position
+    float m_meter_val[2] = { 0.0f, 0.0f };  // dBFS
+    float m_meter_buf[2] = { 0.0f, 0.0f };  // EMA
+
+    // show video source
+    std::atomic_bool m_show = true;
+
+    // graph was silent last frame
+    bool m_last_silent = false;
+
+    // fade out of silent input, see decay_silence()
+    // while it lasts m_decibels and m_tsmooth_buf hold the spectrum from before the fade
+    uint32_t m_decay_frames = 0;
+    float m_decay_peak = 0.0f;  // loudest displayed bin when the fade began, dBFS
+    float m_decay_db = 0.0f;    // dB added to every bin by the fade so far
+
+    // per stage timing, queried through the "get_stats" proc and logged every m_stats_interval seconds
+    StageStats m_stats;
+    float m_stats_elapsed = 0.0f;
+
+    // analysis results in async mode
+    TripleBuffer<SpectrumFrame> m_frames;
 
     // interpolation
-    std::vector<float> m_interp_indices;
+    std::shared_ptr<const InterpLayout> m_interp;
     std::vector<float> m_interp_bufs[2];
 
     // filter
-    Kernel<float> m_kernel;
-    float m_filter_radius = 0.0f;
+    std::shared_ptr<const FilterKernels> m_filter;
+    std::vector<float> m_filter_buf;    // output of the direct filter, swapped with the interpolation buffer
 
     // slope
-    AVXBufR m_slope_modifiers;
+    std::shared_ptr<const float[]> m_slope_modifiers;
+
+    // vertex buffer, (re)created by render() when the count computed in derive() changes
+    gs_vertbuffer_t *m_vbuf = nullptr;
+    size_t m_vbuf_verts = 0;
 
     // rounded caps
-    float m_cap_radius = 0.0f;
-    int m_cap_tris = 4;             // number of triangles each cap is composed of (4 min)
-    std::vector<vec2> m_cap_verts;  // pre-rotated cap vertices (to be translated to final pos)
+    std::shared_ptr<const std::vector<vec2>> m_cap_verts;
 
-    void get_settings(obs_data_t *settings);
+    std::unique_ptr<PendingConfig> build_config(const SourceSettings& settings);    // builder thread, or the constructor
+    void apply_config(PendingConfig& pending);  // m_mtx must be held
 
-    void recapture_audio();
-    void release_audio_capture();
-    bool check_audio_capture(float seconds); // check if capture is valid and retry if not
-    void free_bufs();
+    void filter_interp(unsigned int channel, StageClock& clock);  // apply the filter to m_interp_bufs[channel]
+    void interp_channel(unsigned int channel, const float *decibels, float decay_db, StageClock& clock);    // interpolate and filter into m_interp_bufs[channel]
+    bool decay_silence();   // tick_spectrum() fast path while every channel is silent
+    void end_decay();       // apply the fade to the buffers
 
-    void init_interp(unsigned int sz);
+    void init_frames();
+    void analyze(float seconds);    // m_analysis_mtx must be held
+    void publish_frame();
 
-    void render_curve(gs_effect_t *effect);
-    void render_bars(gs_effect_t *effect);
+    static const GradientEffect *get_effect(); // loads the effect on first use, nullptr on failure
+    gs_technique_t *get_technique(const GradientEffect *fx);
+    void set_effect_params(const GradientEffect *fx, float cpos);
+    bool prepare_vertexbuffer();
+    void render_curve(gs_effect_t *effect, const float *const *decibels, float decay_db, StageClock& clock);
+    void render_bars(gs_effect_t *effect, const float *const *decibels, float decay_db, const float *meter_val, StageClock& clock);
 
     virtual void tick_spectrum(float) = 0;  // process audio data in frequency spectrum mode
     virtual void tick_meter(float);         // process audio data in meter mode
+    bool consume_meter_samples(float seconds, StageClock& clock);   // copy new samples into the meter buffers
+
+    // bit 0 slope, bit 1 exponential smoothing, bit 2 fast peaks (only with smoothing)
+    static size_t spectrum_kernel_index(bool slope, bool smoothing, bool fast_peaks)
+    {
+        return (slope ? 1 : 0) | (smoothing ? 2 : 0) | ((smoothing && fast_peaks) ? 4 : 0);
+    }
 
     // constants
     static const float DB_MIN;
-    static constexpr auto RETRY_DELAY = 2.0f;
 
     inline float dbfs(float mag)
     {
@@ -202,8 +370,23 @@ protected:
             return DB_MIN;
     }
 
+    // value of a bin with no signal, energy bars keep magnitudes instead of dB
+    float empty_bin() const { return m_energy_bars ? 0.0f : DB_MIN; }
+
+    // a silent channel has settled once every displayed bin is below this
+    float silence_threshold() const
+    {
+        if(!m_energy_bars)
+            return (float)(m_floor - 10);
+        return std::pow(10.0f, (float)(m_floor - 10) / (m_power_domain ? 10.0f : 20.0f));
+    }
+
+    // smoothing factor for the spectrum kernels
+    // a moving average of power falls as fast in dB as one of magnitude does with the square root of its factor
+    float spectrum_gravity() const { return m_power_domain ? m_gravity * m_gravity : m_gravity; }
+
 public:
-    WAVSource(obs_data_t *settings, obs_source_t *source);
+    WAVSource(obs_data_t *settings, obs_source_t *source, SIMDLevel simd, const SpectrumKernelTable& spectrum_kernels);
     virtual ~WAVSource();
 
     // no copying
@@ -221,13 +404,22 @@ public:
     void show();
     void hide();
 
+    // offline access to the analysis results, only in spectrum mode without the analysis thread
+    // raw is one dBFS value per FFT bin, otherwise the interpolated and filtered values that render() would draw
+    unsigned int spectrum_channels();
+    size_t spectrum_size(bool raw);
+    bool read_spectrum(unsigned int channel, float *dst, bool raw);
+
+    const StageStats& stats() const { return m_stats; }
+
     static void register_source();
+    static void free_effect();  // requires the graphics context
 
-    // audio capture callback
-    void capture_audio(obs_source_t *source, const audio_data *audio, bool muted);
+    // analysis worker entry point
+    void analyze_async(float seconds);
 
-    // for capturing the final OBS audio output stream
-    void capture_output_bus(size_t mix_idx, const audio_data *audio);
+    // config builder entry point, builds and publishes a config for tick() to swap in
+    void build_async(const SourceSettings& settings);
 
     // constants
     static const bool HAVE_AVX2;
@@ -238,27 +430,45 @@ public:
 class WAVSourceAVX2 : public WAVSource
 {
 public:
-    using WAVSource::WAVSource;
+    WAVSourceAVX2(obs_data_t *settings, obs_source_t *source) : WAVSource(settings, source, SIMDLevel::AVX2, SPECTRUM_KERNELS) {}
     ~WAVSourceAVX2() override {}
 
     void tick_spectrum(float seconds) override;
+
+    static const SpectrumKernelTable SPECTRUM_KERNELS;
 };
 
 class WAVSourceAVX : public WAVSource
 {
 public:
-    using WAVSource::WAVSource;
+    WAVSourceAVX(obs_data_t *settings, obs_source_t *source) : WAVSource(settings, source, SIMDLevel::AVX, SPECTRUM_KERNELS) {}
     ~WAVSourceAVX() override {}
 
     void tick_spectrum(float seconds) override;
+
+    static const SpectrumKernelTable SPECTRUM_KERNELS;
 };
 
 class WAVSourceSSE2 : public WAVSource
 {
 public:
-    using WAVSource::WAVSource;
+    WAVSourceSSE2(obs_data_t *settings, obs_source_t *source) : WAVSource(settings, source, SIMDLevel::SSE2, SPECTRUM_KERNELS) {}
     ~WAVSourceSSE2() override {}
 
     void tick_spectrum(float seconds) override;
-    void tick_meter(float seconds) override;
+
+    static const SpectrumKernelTable SPECTRUM_KERNELS;
+};
+
+// plain C++ version of the spectrum path, the reference the SIMD classes are checked against
+// not used by the plugin
+class WAVSourceScalar : public WAVSource
+{
+public:
+    WAVSourceScalar(obs_data_t *settings, obs_source_t *source) : WAVSource(settings, source, SIMDLevel::SCALAR, SPECTRUM_KERNELS) {}
+    ~WAVSourceScalar() override {}
+
+    void tick_spectrum(float seconds) override;
+
+    static const SpectrumKernelTable SPECTRUM_KERNELS;
 };
@@ -17,22 +17,76 @@
 
 #include "waveform_config.hpp"
 #include "source.hpp"
+#include "analysis_engine.hpp"
+#include "simd_math.hpp"
 #include <immintrin.h>
 #include <algorithm>
 #include <cstring>
 
+// see SpectrumKernel
+template<bool SLOPE, bool SMOOTH, bool FAST_PEAKS>
+DECORATE_AVX2
+static void spectrum_kernel_avx2(const float *mags, const float *slope_modifiers, float *tsmooth, float *out, size_t begin, size_t end, float gravity)
+{
+    constexpr auto step = sizeof(__m256) / sizeof(float);
+    const auto g = _mm256_set1_ps(gravity);
+    const auto g2 = _mm256_sub_ps(_mm256_set1_ps(1.0), g); // 1 - gravity
+    for(size_t i = begin; i < end; i += step)
+    {
+        auto mag = _mm256_load_ps(&mags[i]);
+
+        // boost high frequencies
+        if constexpr(SLOPE)
+            mag = _mm256_mul_ps(mag, _mm256_load_ps(&slope_modifiers[i]));
+
+        // time domain smoothing
+        if constexpr(SMOOTH)
+        {
+            auto old = _mm256_load_ps(&tsmooth[i]);
+
+            // take new values immediately if larger
+            if constexpr(FAST_PEAKS)
+                old = _mm256_max_ps(mag, old);
+
+            // (gravity * oldval) + ((1 - gravity) * newval)
+            mag = _mm256_fmadd_ps(g, old, _mm256_mul_ps(g2, mag));
+            _mm256_store_ps(&tsmooth[i], mag);
+        }
+
+        _mm256_store_ps(&out[i], mag);
+    }
+}
+
+// fast peaks only apply with smoothing, so those slots are never selected
+const SpectrumKernelTable WAVSourceAVX2::SPECTRUM_KERNELS = {
+    spectrum_kernel_avx2<false, false, false>,
+    spectrum_kernel_avx2<true, false, false>,
+    spectrum_kernel_avx2<false, true, false>,
+    spectrum_kernel_avx2<true, true, false>,
+    spectrum_kernel_avx2<false, false, false>,
+    spectrum_kernel_avx2<true, false, false>,
+    spectrum_kernel_avx2<false, true, true>,
+    spectrum_kernel_avx2<true, true, true>
+};
+
 DECORATE_AVX2
 void WAVSourceAVX2::tick_spectrum(float seconds)
 {
     //std::lock_guard lock(m_mtx); // now locked in tick()
-    if(!check_audio_capture(seconds))
+    if(m_engine == nullptr)
+        return;
+
+    StageClock clock(m_stats);
+    // capture, window and FFT happen in the shared engine, only the first subscriber each frame pays for them
+    std::unique_lock engine_lock(m_engine->mutex());
+    if(!m_engine->process(obs_get_video_frame_time(), seconds, m_show, clock))
         return;
 
     if(m_capture_channels == 0)
         return;
 
-    const auto bufsz = m_fft_size * sizeof(float);
     const auto outsz = m_fft_size / 2; // discard bins at nyquist and above
+    const auto& runs = m_interp->bin_runs; // everything past the FFT only covers the bins interpolation reads
     constexpr auto step = sizeof(__m256) / sizeof(float);
 
     // reset and stop processing when source is not being displayed
@@ -45,36 +99,26 @@ void WAVSourceAVX2::tick_spectrum(float seconds)
                 memset(m_tsmooth_buf[channel].get(), 0, outsz * sizeof(float));
         for(auto channel = 0; channel < (m_stereo ? 2 : 1); ++channel)
             for(size_t i = 0; i < outsz; ++i)
-                m_decibels[channel][i] = DB_MIN;
+                m_decibels[channel][i] = empty_bin();
+        m_decay_frames = 0;
+        m_decay_db = 0.0f;
         m_last_silent = true;
         return;
     }
 
+    clock.begin(Stage::DECIBELS);
+    if(decay_silence())
+        return;
+
     auto silent_channels = 0u;
     for(auto channel = 0u; channel < m_capture_channels; ++channel)
     {
-        // get captured audio
-        if(m_capturebufs[channel].size >= bufsz)
-        {
-            circlebuf_peek_front(&m_capturebufs[channel], m_fft_input.get(), bufsz);
-            circlebuf_pop_front(&m_capturebufs[channel], nullptr, m_capturebufs[channel].size - bufsz);
-        }
-        else
+        if(!m_engine->has_data(channel))
             continue;
 
-        // skip FFT for silent audio
-        bool silent = true;
-        const auto zero = _mm256_setzero_ps();
-        for(auto i = 0u; i < m_fft_size; i += step)
-        {
-            auto mask = _mm256_cmp_ps(zero, _mm256_load_ps(&m_fft_input[i]), _CMP_EQ_OQ);
-            if(_mm256_movemask_ps(mask) != 0xff)
-            {
-                silent = false;
-                m_last_silent = false;
-                break;
-            }
-        }
+        const bool silent = m_engine->silent(channel);
+        if(!silent)
+            m_last_silent = false;
 
         // wait for gravity
         if(silent)
@@ -82,8 +126,9 @@ void WAVSourceAVX2::tick_spectrum(float seconds)
             if(m_last_silent)
                 continue;
             bool outsilent = true;
-            auto floor = _mm256_set1_ps((float)(m_floor - 10));
-            for(size_t i = 0; i < outsz; i += step)
+            auto floor = _mm256_set1_ps(silence_threshold());
+            for(auto run = runs.begin(); outsilent && (run != runs.end()); ++run)
+            for(size_t i = run->first; i < run->second; i += step)
             {
                 const auto ch = (m_stereo) ? channel : 0u;
                 auto mask = _mm256_cmp_ps(floor, _mm256_load_ps(&m_decibels[ch][i]), _CMP_GT_OQ);
@@ -101,86 +146,54 @@ void WAVSourceAVX2::tick_spectrum(float seconds)
             }
         }
 
-        // window function
-        if(m_window_func != FFTWindow::NONE)
-        {
-            auto inbuf = m_fft_input.get();
-            auto mulbuf = m_window_coefficients.get();
-            for(auto i = 0u; i < m_fft_size; i += step)
-                _mm256_store_ps(&inbuf[i], _mm256_mul_ps(_mm256_load_ps(&inbuf[i]), _mm256_load_ps(&mulbuf[i])));
-        }
-
-        // FFT
-        if(m_fft_plan != nullptr)
-            fftwf_execute(m_fft_plan);
-        else
-            continue;
-
-        // normalize FFT output and convert to dBFS
-        const auto shuffle_mask = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
-        const auto mag_coefficient = _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_set1_ps((float)m_fft_size));
-        const auto g = _mm256_set1_ps(m_gravity);
-        const auto g2 = _mm256_sub_ps(_mm256_set1_ps(1.0), g); // 1 - gravity
-        const bool slope = m_slope > 0.0f;
-        for(size_t i = 0; i < outsz; i += step)
-        {
-            // this *should* be faster than 2x vgatherxxx instructions
-            // load 8 real/imaginary pairs and group the r/i components in the low/high halves
-            const float *buf = &m_fft_output[i][0]; // first element of complex (float[2])
-            auto chunk1 = _mm256_permutevar8x32_ps(_mm256_load_ps(buf), shuffle_mask);
-            auto chunk2 = _mm256_permutevar8x32_ps(_mm256_load_ps(&buf[step]), shuffle_mask);
-
-            // pack the real and imaginary components into separate vectors
-            auto rvec = _mm256_permute2f128_ps(chunk1, chunk2, 0 | (2 << 4));
-            auto ivec = _mm256_permute2f128_ps(chunk1, chunk2, 1 | (3 << 4));
-
-            // calculate normalized magnitude
-            // 2 * magnitude / N
-            auto mag = _mm256_sqrt_ps(_mm256_fmadd_ps(ivec, ivec, _mm256_mul_ps(rvec, rvec))); // magnitude sqrt(r^2 + i^2)
-            mag = _mm256_mul_ps(mag, mag_coefficient); // 2 * magnitude / N with precomputed quotient
-
-            // boost high frequencies
-            if(slope)
-                mag = _mm256_mul_ps(mag, _mm256_load_ps(&m_slope_modifiers[i]));
-
-            // time domain smoothing
-            if(m_tsmoothing == TSmoothingMode::EXPONENTIAL)
-            {
-                // take new values immediately if larger
-                if(m_fast_peaks)
-                    _mm256_store_ps(&m_tsmooth_buf[channel][i], _mm256_max_ps(mag, _mm256_load_ps(&m_tsmooth_buf[channel][i])));
-
-                // (gravity * oldval) + ((1 - gravity) * newval)
-                mag = _mm256_fmadd_ps(g, _mm256_load_ps(&m_tsmooth_buf[channel][i]), _mm256_mul_ps(g2, mag));
-                _mm256_store_ps(&m_tsmooth_buf[channel][i], mag);
-            }
-
-            _mm256_store_ps(&m_decibels[channel][i], mag); // end of the line for AVX
-        }
+        // apply slope and smoothing to the normalized magnitudes
+        for(const auto& [begin, end] : runs)
+            m_spectrum_kernel(m_engine->magnitudes(channel), m_slope_modifiers.get(), m_tsmooth_buf[channel].get(), m_decibels[channel].get(), begin, end, spectrum_gravity());
     }
+    engine_lock.unlock();
 
     if(m_last_silent)
         return;
 
     if(m_output_channels > m_capture_channels)
-        memcpy(m_decibels[1].get(), m_decibels[0].get(), outsz * sizeof(float));
+        for(const auto& [begin, end] : runs)
+            memcpy(&m_decibels[1][begin], &m_decibels[0][begin], (end - begin) * sizeof(float));
 
     // dBFS conversion
-    // 20 * log(2 * magnitude / N)
-    if(m_stereo)
-    {
-        for(auto channel = 0; channel < 2; ++channel)
-            for(size_t i = 0; i < outsz; ++i)
-                m_decibels[channel][i] = dbfs(m_decibels[channel][i]);
-    }
-    else if(m_capture_channels > 1)
-    {
-        for(size_t i = 0; i < outsz; ++i)
-            m_decibels[0][i] = dbfs((m_decibels[0][i] + m_decibels[1][i]) * 0.5f);
-    }
-    else
+    // 20 * log(2 * magnitude / N), or 10 * log(4 * power / N^2) in the power domain
+    const auto db_per_ln = m_power_domain ? simd_math::DB_PER_LN_POWER : simd_math::DB_PER_LN;
+    for(const auto& [begin, end] : runs)
     {
-        for(size_t i = 0; i < outsz; ++i)
-            m_decibels[0][i] = dbfs(m_decibels[0][i]);
+        if(m_energy_bars)
+        {
+            // bars convert their sums instead, only the downmix is left
+            if(!m_stereo && (m_capture_channels > 1))
+            {
+                const auto half = _mm256_set1_ps(0.5f);
+                for(size_t i = begin; i < end; i += step)
+                    _mm256_store_ps(&m_decibels[0][i], _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(&m_decibels[0][i]), _mm256_load_ps(&m_decibels[1][i])), half));
+            }
+        }
+        else if(m_stereo)
+        {
+            for(auto channel = 0; channel < 2; ++channel)
+                for(size_t i = begin; i < end; i += step)
+                    _mm256_store_ps(&m_decibels[channel][i], dbfs_avx2(_mm256_load_ps(&m_decibels[channel][i]), db_per_ln));
+        }
+        else if(m_capture_channels > 1)
+        {
+            // mono downmix in the same pass
+            const auto half = _mm256_set1_ps(0.5f);
+            for(size_t i = begin; i < end; i += step)
+            {
+                auto mix = _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(&m_decibels[0][i]), _mm256_load_ps(&m_decibels[1][i])), half);
+                _mm256_store_ps(&m_decibels[0][i], dbfs_avx2(mix, db_per_ln));
+            }
+        }
+        else
+        {
+            for(size_t i = begin; i < end; i += step)
+                _mm256_store_ps(&m_decibels[0][i], dbfs_avx2(_mm256_load_ps(&m_decibels[0][i]), db_per_ln));
+        }
     }
 }
@@ -0,0 +1,165 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "waveform_config.hpp"
+#include "source.hpp"
+#include "analysis_engine.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+template<bool SLOPE, bool SMOOTH, bool FAST_PEAKS>
+static void spectrum_kernel_scalar(const float *mags, const float *slope_modifiers, float *tsmooth, float *out, size_t begin, size_t end, float gravity)
+{
+    const auto g = gravity;
+    const auto g2 = 1.0f - g;
+    for(size_t i = begin; i < end; ++i)
+    {
+        auto mag = mags[i];
+
+        if constexpr(SLOPE)
+            mag *= slope_modifiers[i];
+
+        if constexpr(SMOOTH)
+        {
+            auto old = tsmooth[i];
+            if constexpr(FAST_PEAKS)
+                old = std::max(mag, old);
+
+            mag = (g * old) + (g2 * mag);
+            tsmooth[i] = mag;
+        }
+
+        out[i] = mag;
+    }
+}
+
+const SpectrumKernelTable WAVSourceScalar::SPECTRUM_KERNELS = {
+    spectrum_kernel_scalar<false, false, false>,
+    spectrum_kernel_scalar<true, false, false>,
+    spectrum_kernel_scalar<false, true, false>,
+    spectrum_kernel_scalar<true, true, false>,
+    spectrum_kernel_scalar<false, false, false>,
+    spectrum_kernel_scalar<true, false, false>,
+    spectrum_kernel_scalar<false, true, true>,
+    spectrum_kernel_scalar<true, true, true>
+};
+
+// plain C++ version of WAVSourceAVX2::tick_spectrum(), the SIMD versions must agree with it
+// see comments of WAVSourceAVX2
+void WAVSourceScalar::tick_spectrum(float seconds)
+{
+    if(m_engine == nullptr)
+        return;
+
+    StageClock clock(m_stats);
+    std::unique_lock engine_lock(m_engine->mutex());
+    if(!m_engine->process(obs_get_video_frame_time(), seconds, m_show, clock))
+        return;
+
+    if(m_capture_channels == 0)
+        return;
+
+    const auto outsz = m_fft_size / 2;
+    const auto& runs = m_interp->bin_runs;
+
+    if(!m_show)
+    {
+        if(m_last_silent)
+            return;
+        for(auto channel = 0u; channel < m_capture_channels; ++channel)
+            if(m_tsmooth_buf[channel] != nullptr)
+                memset(m_tsmooth_buf[channel].get(), 0, outsz * sizeof(float));
+        for(auto channel = 0; channel < (m_stereo ? 2 : 1); ++channel)
+            for(size_t i = 0; i < outsz; ++i)
+                m_decibels[channel][i] = empty_bin();
+        m_decay_frames = 0;
+        m_decay_db = 0.0f;
+        m_last_silent = true;
+        return;
+    }
+
+    clock.begin(Stage::DECIBELS);
+    if(decay_silence())
+        return;
+
+    auto silent_channels = 0u;
+    for(auto channel = 0u; channel < m_capture_channels; ++channel)
+    {
+        if(!m_engine->has_data(channel))
+            continue;
+
+        const bool silent = m_engine->silent(channel);
+        if(!silent)
+            m_last_silent = false;
+
+        if(silent)
+        {
+            if(m_last_silent)
+                continue;
+            const auto ch = (m_stereo) ? channel : 0u;
+            const auto floor = silence_threshold();
+            const auto below = [floor](float db) { return floor > db; };
+            if(std::all_of(runs.begin(), runs.end(), [&](const auto& run) { return std::all_of(&m_decibels[ch][run.first], &m_decibels[ch][run.second], below); }))
+            {
+                if(++silent_channels >= m_capture_channels)
+                    m_last_silent = true;
+                continue;
+            }
+        }
+
+        for(const auto& [begin, end] : runs)
+            m_spectrum_kernel(m_engine->magnitudes(channel), m_slope_modifiers.get(), m_tsmooth_buf[channel].get(), m_decibels[channel].get(), begin, end, spectrum_gravity());
+    }
+    engine_lock.unlock();
+
+    if(m_last_silent)
+        return;
+
+    if(m_output_channels > m_capture_channels)
+        for(const auto& [begin, end] : runs)
+            memcpy(&m_decibels[1][begin], &m_decibels[0][begin], (end - begin) * sizeof(float));
+
+    // the SIMD versions clamp to FLT_MIN before the log, denormals included
+    const auto db_scale = m_power_domain ? 10.0f : 20.0f;
+    const auto to_db = [db_scale](float mag) { return db_scale * std::log10(std::max(mag, std::numeric_limits<float>::min())); };
+    for(const auto& [begin, end] : runs)
+    {
+        if(m_energy_bars)
+        {
+            if(!m_stereo && (m_capture_channels > 1))
+                for(size_t i = begin; i < end; ++i)
+                    m_decibels[0][i] = (m_decibels[0][i] + m_decibels[1][i]) * 0.5f;
+        }
+        else if(m_stereo)
+        {
+            for(auto channel = 0; channel < 2; ++channel)
+                for(size_t i = begin; i < end; ++i)
+                    m_decibels[channel][i] = to_db(m_decibels[channel][i]);
+        }
+        else if(m_capture_channels > 1)
+        {
+            for(size_t i = begin; i < end; ++i)
+                m_decibels[0][i] = to_db((m_decibels[0][i] + m_decibels[1][i]) * 0.5f);
+        }
+        else
+        {
+            for(size_t i = begin; i < end; ++i)
+                m_decibels[0][i] = to_db(m_decibels[0][i]);
+        }
+    }
+}
@@ -17,24 +17,70 @@
 
 #include "waveform_config.hpp"
 #include "source.hpp"
+#include "analysis_engine.hpp"
+#include "simd_math.hpp"
 #include <immintrin.h>
 #include <algorithm>
 #include <cstring>
 
+template<bool SLOPE, bool SMOOTH, bool FAST_PEAKS>
+DECORATE_SSE2
+static void spectrum_kernel_sse2(const float *mags, const float *slope_modifiers, float *tsmooth, float *out, size_t begin, size_t end, float gravity)
+{
+    constexpr auto step = sizeof(__m128) / sizeof(float);
+    const auto g = _mm_set1_ps(gravity);
+    const auto g2 = _mm_sub_ps(_mm_set1_ps(1.0), g);
+    for(size_t i = begin; i < end; i += step)
+    {
+        auto mag = _mm_load_ps(&mags[i]);
+
+        if constexpr(SLOPE)
+            mag = _mm_mul_ps(mag, _mm_load_ps(&slope_modifiers[i]));
+
+        if constexpr(SMOOTH)
+        {
+            auto old = _mm_load_ps(&tsmooth[i]);
+            if constexpr(FAST_PEAKS)
+                old = _mm_max_ps(mag, old);
+
+            mag = _mm_add_ps(_mm_mul_ps(g, old), _mm_mul_ps(g2, mag));
+            _mm_store_ps(&tsmooth[i], mag);
+        }
+
+        _mm_store_ps(&out[i], mag);
+    }
+}
+
+const SpectrumKernelTable WAVSourceSSE2::SPECTRUM_KERNELS = {
+    spectrum_kernel_sse2<false, false, false>,
+    spectrum_kernel_sse2<true, false, false>,
+    spectrum_kernel_sse2<false, true, false>,
+    spectrum_kernel_sse2<true, true, false>,
+    spectrum_kernel_sse2<false, false, false>,
+    spectrum_kernel_sse2<true, false, false>,
+    spectrum_kernel_sse2<false, true, true>,
+    spectrum_kernel_sse2<true, true, true>
+};
+
 // compatibility fallback using at most SSE2 instructions
 // see comments of WAVSourceAVX2
 DECORATE_SSE2
 void WAVSourceSSE2::tick_spectrum(float seconds)
 {
     //std::lock_guard lock(m_mtx); // now locked in tick()
-    if(!check_audio_capture(seconds))
+    if(m_engine == nullptr)
+        return;
+
+    StageClock clock(m_stats);
+    std::unique_lock engine_lock(m_engine->mutex());
+    if(!m_engine->process(obs_get_video_frame_time(), seconds, m_show, clock))
         return;
 
     if(m_capture_channels == 0)
         return;
 
-    const auto bufsz = m_fft_size * sizeof(float);
     const auto outsz = m_fft_size / 2;
+    const auto& runs = m_interp->bin_runs;
     constexpr auto step = sizeof(__m128) / sizeof(float);
 
     if(!m_show)
@@ -46,42 +92,35 @@ void WAVSourceSSE2::tick_spectrum(float seconds)
                 memset(m_tsmooth_buf[channel].get(), 0, outsz * sizeof(float));
         for(auto channel = 0; channel < (m_stereo ? 2 : 1); ++channel)
             for(size_t i = 0; i < outsz; ++i)
-                m_decibels[channel][i] = DB_MIN;
+                m_decibels[channel][i] = empty_bin();
+        m_decay_frames = 0;
+        m_decay_db = 0.0f;
         m_last_silent = true;
         return;
     }
 
+    clock.begin(Stage::DECIBELS);
+    if(decay_silence())
+        return;
+
     auto silent_channels = 0u;
     for(auto channel = 0u; channel < m_capture_channels; ++channel)
     {
-        if(m_capturebufs[channel].size >= bufsz)
-        {
-            circlebuf_peek_front(&m_capturebufs[channel], m_fft_input.get(), bufsz);
-            circlebuf_pop_front(&m_capturebufs[channel], nullptr, m_capturebufs[channel].size - bufsz);
-        }
-        else
+        if(!m_engine->has_data(channel))
             continue;
 
-        bool silent = true;
-        const auto zero = _mm_setzero_ps();
-        for(auto i = 0u; i < m_fft_size; i += step)
-        {
-            auto mask = _mm_cmpeq_ps(zero, _mm_load_ps(&m_fft_input[i]));
-            if(_mm_movemask_ps(mask) != 0xf)
-            {
-                silent = false;
-                m_last_silent = false;
-                break;
-            }
-        }
+        const bool silent = m_engine->silent(channel);
+        if(!silent)
+            m_last_silent = false;
 
         if(silent)
         {
             if(m_last_silent)
                 continue;
             bool outsilent = true;
-            auto floor = _mm_set1_ps((float)(m_floor - 10));
-            for(size_t i = 0; i < outsz; i += step)
+            auto floor = _mm_set1_ps(silence_threshold());
+            for(auto run = runs.begin(); outsilent && (run != runs.end()); ++run)
+            for(size_t i = run->first; i < run->second; i += step)
             {
                 const auto ch = (m_stereo) ? channel : 0u;
                 auto mask = _mm_cmpgt_ps(floor, _mm_load_ps(&m_decibels[ch][i]));
@@ -99,148 +138,50 @@ void WAVSourceSSE2::tick_spectrum(float seconds)
             }
         }
 
-        if(m_window_func != FFTWindow::NONE)
-        {
-            auto inbuf = m_fft_input.get();
-            auto mulbuf = m_window_coefficients.get();
-            for(auto i = 0u; i < m_fft_size; i += step)
-                _mm_store_ps(&inbuf[i], _mm_mul_ps(_mm_load_ps(&inbuf[i]), _mm_load_ps(&mulbuf[i])));
-        }
-
-        if(m_fft_plan != nullptr)
-            fftwf_execute(m_fft_plan);
-        else
-            continue;
-
-        constexpr auto shuffle_mask_r = 0 | (2 << 2) | (0 << 4) | (2 << 6);
-        constexpr auto shuffle_mask_i = 1 | (3 << 2) | (1 << 4) | (3 << 6);
-        const auto mag_coefficient = _mm_div_ps(_mm_set1_ps(2.0f), _mm_set1_ps((float)m_fft_size));
-        const auto g = _mm_set1_ps(m_gravity);
-        const auto g2 = _mm_sub_ps(_mm_set1_ps(1.0), g);
-        const bool slope = m_slope > 0.0f;
-        for(size_t i = 0; i < outsz; i += step)
-        {
-            // load 4 real/imaginary pairs and pack the r/i components into separate vectors
-            const float *buf = &m_fft_output[i][0];
-            auto chunk1 = _mm_load_ps(buf);
-            auto chunk2 = _mm_load_ps(&buf[4]);
-            auto rvec = _mm_shuffle_ps(chunk1, chunk2, shuffle_mask_r);
-            auto ivec = _mm_shuffle_ps(chunk1, chunk2, shuffle_mask_i);
-
-            auto mag = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ivec, ivec), _mm_mul_ps(rvec, rvec)));
-            mag = _mm_mul_ps(mag, mag_coefficient);
-
-            if(slope)
-                mag = _mm_mul_ps(mag, _mm_load_ps(&m_slope_modifiers[i]));
-
-            if(m_tsmoothing == TSmoothingMode::EXPONENTIAL)
-            {
-                if(m_fast_peaks)
-                    _mm_store_ps(&m_tsmooth_buf[channel][i], _mm_max_ps(mag, _mm_load_ps(&m_tsmooth_buf[channel][i])));
-
-                mag = _mm_add_ps(_mm_mul_ps(g, _mm_load_ps(&m_tsmooth_buf[channel][i])), _mm_mul_ps(g2, mag));
-                _mm_store_ps(&m_tsmooth_buf[channel][i], mag);
-            }
-
-            _mm_store_ps(&m_decibels[channel][i], mag);
-        }
+        for(const auto& [begin, end] : runs)
+            m_spectrum_kernel(m_engine->magnitudes(channel), m_slope_modifiers.get(), m_tsmooth_buf[channel].get(), m_decibels[channel].get(), begin, end, spectrum_gravity());
     }
+    engine_lock.unlock();
 
     if(m_last_silent)
         return;
 
     if(m_output_channels > m_capture_channels)
-        memcpy(m_decibels[1].get(), m_decibels[0].get(), outsz * sizeof(float));
+        for(const auto& [begin, end] : runs)
+            memcpy(&m_decibels[1][begin], &m_decibels[0][begin], (end - begin) * sizeof(float));
 
-    if(m_stereo)
-    {
-        for(auto channel = 0; channel < 2; ++channel)
-            for(size_t i = 0; i < outsz; ++i)
-                m_decibels[channel][i] = dbfs(m_decibels[channel][i]);
-    }
-    else if(m_capture_channels > 1)
-    {
-        for(size_t i = 0; i < outsz; ++i)
-            m_decibels[0][i] = dbfs((m_decibels[0][i] + m_decibels[1][i]) * 0.5f);
-    }
-    else
-    {
-        for(size_t i = 0; i < outsz; ++i)
-            m_decibels[0][i] = dbfs(m_decibels[0][i]);
-    }
-}
-
-void WAVSourceSSE2::tick_meter(float seconds)
-{
-    if(!check_audio_capture(seconds))
-        return;
-
-    if(m_capture_channels == 0)
-        return;
-
-    const auto outsz = m_fft_size;
-
-    for(auto channel = 0u; channel < m_capture_channels; ++channel)
+    const auto db_per_ln = m_power_domain ? simd_math::DB_PER_LN_POWER : simd_math::DB_PER_LN;
+    for(const auto& [begin, end] : runs)
     {
-        while(m_capturebufs[channel].size > 0)
+        if(m_energy_bars)
         {
-            auto consume = m_capturebufs[channel].size;
-            auto max = (m_fft_size - m_meter_pos[channel]) * sizeof(float);
-            if(consume >= max)
+            // bars convert their sums instead, only the downmix is left
+            if(!m_stereo && (m_capture_channels > 1))
             {
-                circlebuf_pop_front(&m_capturebufs[channel], &m_decibels[channel][m_meter_pos[channel]], max);
-                m_meter_pos[channel] = 0;
-            }
-            else
-            {
-                circlebuf_pop_front(&m_capturebufs[channel], &m_decibels[channel][m_meter_pos[channel]], consume);
-                m_meter_pos[channel] += consume / sizeof(float);
+                const auto half = _mm_set1_ps(0.5f);
+                for(size_t i = begin; i < end; i += step)
+                    _mm_store_ps(&m_decibels[0][i], _mm_mul_ps(_mm_add_ps(_mm_load_ps(&m_decibels[0][i]), _mm_load_ps(&m_decibels[1][i])), half));
             }
         }
-    }
-
-    if(!m_show)
-        return;
-
-    for(auto channel = 0u; channel < m_capture_channels; ++channel)
-    {
-        if(m_meter_rms)
+        else if(m_stereo)
         {
-            float sum = 0.0f;
-            for(size_t i = 0; i < outsz; ++i)
-            {
-                auto val = m_decibels[channel][i];
-                sum += val * val;
-            }
-            const auto g = m_gravity;
-            const auto g2 = 1.0f - g;
-            auto rms = std::sqrt(sum / m_fft_size);
-            if(m_tsmoothing == TSmoothingMode::EXPONENTIAL)
+            for(auto channel = 0; channel < 2; ++channel)
+                for(size_t i = begin; i < end; i += step)
+                    _mm_store_ps(&m_decibels[channel][i], dbfs_sse2(_mm_load_ps(&m_decibels[channel][i]), db_per_ln));
+        }
+        else if(m_capture_channels > 1)
+        {
+            const auto half = _mm_set1_ps(0.5f);
+            for(size_t i = begin; i < end; i += step)
             {
-                if(!m_fast_peaks || (rms <= m_meter_buf[channel]))
-                    rms = (g * m_meter_buf[channel]) + (g2 * rms);
+                auto mix = _mm_mul_ps(_mm_add_ps(_mm_load_ps(&m_decibels[0][i]), _mm_load_ps(&m_decibels[1][i])), half);
+                _mm_store_ps(&m_decibels[0][i], dbfs_sse2(mix, db_per_ln));
             }
-            m_meter_buf[channel] = rms;
-            m_meter_val[channel] = dbfs(rms);
         }
         else
         {
-            const auto g = m_gravity;
-            const auto g2 = 1.0f - g;
-            float max = 0.0f;
-            for(size_t i = 0; i < outsz; ++i)
-            {
-                auto val = std::abs(m_decibels[channel][i]);
-                if(val > max)
-                    max = val;
-            }
-            if(m_tsmoothing == TSmoothingMode::EXPONENTIAL)
-            {
-                if(!m_fast_peaks || (max <= m_meter_buf[channel]))
-                    max = (g * m_meter_buf[channel]) + (g2 * max);
-            }
-            m_meter_buf[channel] = max;
-            m_meter_val[channel] = dbfs(max);
+            for(size_t i = begin; i < end; i += step)
+                _mm_store_ps(&m_decibels[0][i], dbfs_sse2(_mm_load_ps(&m_decibels[0][i]), db_per_ln));
         }
     }
 }
@@ -0,0 +1,162 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "stage_stats.hpp"
+#include "module.hpp"
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+static const char *const stage_names[] = {
+    "capture",
+    "window",
+    "fft",
+    "magnitude",
+    "decibels",
+    "meter",
+    "interp",
+    "filter",
+    "vertices",
+    "draw"
+};
+
+static const char *const profiler_names[] = {
+    MODULE_NAME ": capture",
+    MODULE_NAME ": window",
+    MODULE_NAME ": fft",
+    MODULE_NAME ": magnitude",
+    MODULE_NAME ": dB conversion",
+    MODULE_NAME ": meter",
+    MODULE_NAME ": interpolation",
+    MODULE_NAME ": filter",
+    MODULE_NAME ": vertex build",
+    MODULE_NAME ": draw"
+};
+
+static_assert(std::size(stage_names) == StageStats::NUM_STAGES);
+static_assert(std::size(profiler_names) == StageStats::NUM_STAGES);
+
+const char *StageStats::name(Stage stage)
+{
+    return stage_names[(size_t)stage];
+}
+
+const char *StageStats::profiler_name(Stage stage)
+{
+    return profiler_names[(size_t)stage];
+}
+
+void StageStats::record(const uint64_t *times, uint32_t mask)
+{
+    std::lock_guard lock(m_mtx);
+    for(auto i = 0u; i < NUM_STAGES; ++i)
+    {
+        if(!(mask & (1u << i)))
+            continue;
+        m_times[i][m_count[i] % HISTORY] = (uint32_t)std::min<uint64_t>(times[i], UINT32_MAX);
+        ++m_count[i];
+    }
+}
+
+StageStats::Summary StageStats::summary(Stage stage) const
+{
+    const auto idx = (size_t)stage;
+    uint32_t sorted[HISTORY];
+    Summary res;
+    {
+        std::lock_guard lock(m_mtx);
+        res.count = std::min(m_count[idx], HISTORY);
+        std::copy_n(m_times[idx], res.count, sorted);
+    }
+    if(res.count == 0)
+        return res;
+
+    // nearest rank
+    const auto end = sorted + res.count;
+    std::nth_element(sorted, sorted + ((res.count - 1) / 2), end);
+    res.p50 = sorted[(res.count - 1) / 2];
+    const auto p99 = ((res.count * 99) + 99) / 100 - 1;
+    std::nth_element(sorted, sorted + p99, end);
+    res.p99 = sorted[p99];
+    res.max = *std::max_element(sorted + p99, end);
+    return res;
+}
+
+void StageStats::reset()
+{
+    std::lock_guard lock(m_mtx);
+    std::fill(std::begin(m_count), std::end(m_count), 0);
+}
+
+std::string StageStats::to_json() const
+{
+    std::string json = "{";
+    char buf[160];
+    for(auto i = 0u; i < NUM_STAGES; ++i)
+    {
+        const auto stats = summary((Stage)i);
+        if(stats.count == 0)
+            continue;
+        snprintf(buf, sizeof(buf), "%s\"%s\": {\"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"frames\": %zu}", (json.size() > 1) ? ", " : "",
+                 stage_names[i], stats.p50 * 1e-3, stats.p99 * 1e-3, stats.max * 1e-3, stats.count);
+        json += buf;
+    }
+    return json + "}";
+}
+
+std::string StageStats::to_string() const
+{
+    std::string str;
+    char buf[128];
+    for(auto i = 0u; i < NUM_STAGES; ++i)
+    {
+        const auto stats = summary((Stage)i);
+        if(stats.count == 0)
+            continue;
+        snprintf(buf, sizeof(buf), "%s%s %.1f/%.1f/%.1f", str.empty() ? "" : ", ", stage_names[i], stats.p50 * 1e-3, stats.p99 * 1e-3, stats.max * 1e-3);
+        str += buf;
+    }
+    return str;
+}
+
+StageClock::~StageClock()
+{
+    end();
+    if(m_mask != 0)
+        m_stats.record(m_times, m_mask);
+}
+
+void StageClock::begin(Stage stage)
+{
+    end();
+    m_stage = stage;
+    profile_start(profiler_names[(size_t)stage]);
+    m_start = os_gettime_ns();
+}
+
+void StageClock::end()
+{
+    if(m_stage == Stage::COUNT)
+        return;
+    const auto idx = (size_t)m_stage;
+    m_times[idx] += os_gettime_ns() - m_start;
+    m_mask |= 1u << idx;
+    profile_end(profiler_names[idx]);
+    m_stage = Stage::COUNT;
+}
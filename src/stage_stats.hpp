@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <mutex>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// processing stages of a source, timed once per frame
+enum class Stage
+{
+    CAPTURE,    // draining captured audio
+    WINDOW,     // copy of the FFT input with silence check and window function
+    FFT,
+    MAGNITUDE,  // power accumulation and normalization
+    DECIBELS,   // slope, temporal smoothing and dBFS conversion
+    METER,      // RMS/peak of the meter modes
+    INTERP,     // interpolation onto curve points or bars
+    FILTER,     // spatial filter of the interpolated values
+    VERTICES,   // vertex buffer build
+    DRAW,       // vertex buffer upload and draw calls
+    COUNT
+};
+
+// rolling per stage timing of one source, the last HISTORY frames of each stage are kept
+// written from the analysis and render threads, read by the proc handler and the periodic log
+class StageStats
+{
+public:
+    static constexpr size_t HISTORY = 512;
+    static constexpr size_t NUM_STAGES = (size_t)Stage::COUNT;
+
+    struct Summary
+    {
+        uint32_t p50 = 0;   // nanoseconds
+        uint32_t p99 = 0;
+        uint32_t max = 0;
+        size_t count = 0;   // frames in the history
+    };
+
+    // one frame worth of stage times, only stages with their bit set in mask are recorded
+    void record(const uint64_t *times, uint32_t mask);
+
+    Summary summary(Stage stage) const;
+    void reset();
+
+    // {"fft": {"p50": 1.2, "p99": 3.4, "max": 5.6, "frames": 512}, ...} in microseconds, stages without data are left out
+    std::string to_json() const;
+
+    // "fft 1.2/3.4/5.6, ..." p50/p99/max in microseconds, for the log
+    std::string to_string() const;
+
+    static const char *name(Stage stage);          // short key, used in JSON and the log
+    static const char *profiler_name(Stage stage); // OBS profiler scope name, static storage
+
+private:
+    mutable std::mutex m_mtx;
+    uint32_t m_times[NUM_STAGES][HISTORY] = {};
+    size_t m_count[NUM_STAGES] = {};    // frames recorded since the last reset
+};
+
+// times consecutive stages of one frame, and opens an OBS profiler scope for each of them
+// a stage may be entered more than once (per hop or per channel), its times add up to a single sample
+// which is recorded when the clock goes out of scope
+class StageClock
+{
+public:
+    explicit StageClock(StageStats& stats) : m_stats(stats) {}
+    ~StageClock();
+
+    // no copying
+    StageClock(const StageClock&) = delete;
+    StageClock& operator=(const StageClock&) = delete;
+
+    void begin(Stage stage);    // ends the current stage, if any
+    void end();
+
+private:
+    StageStats& m_stats;
+    Stage m_stage = Stage::COUNT;
+    uint64_t m_start = 0;
+    uint64_t m_times[StageStats::NUM_STAGES] = {};
+    uint32_t m_mask = 0;
+};
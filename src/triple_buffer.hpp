@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// lock-free single-writer/single-reader triple buffer
+// the writer fills back() and publish()es it, the reader calls update() to swap in the newest published buffer
+// neither side ever waits, the reader always sees the latest complete buffer and the writer never overwrites it
+template<typename T>
+class TripleBuffer
+{
+    static constexpr unsigned int INDEX_MASK = 3;
+    static constexpr unsigned int DIRTY = 4;   // middle buffer holds a frame the reader hasn't seen yet
+
+    T m_bufs[3];
+    std::atomic_uint m_middle{ 1 };     // index of the shared buffer (plus DIRTY flag)
+    unsigned int m_back = 0;            // owned by the writer
+    unsigned int m_front = 2;           // owned by the reader
+
+public:
+    // writer: buffer to fill in
+    T& back() { return m_bufs[m_back]; }
+
+    // writer: hand the back buffer to the reader
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // reader: swap in the newest published buffer, returns false if nothing new was published
+    bool update()
+    {
+        if(!(m_middle.load(std::memory_order_relaxed) & DIRTY))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // reader: latest complete buffer
+    const T& front() const { return m_bufs[m_front]; }
+
+    // direct access for (re)initialization
+    // NOT thread safe
+    T& operator[](size_t idx) { return m_bufs[idx]; }
+
+    void reset()
+    {
+        m_middle.store(1, std::memory_order_relaxed);
+        m_back = 0;
+        m_front = 2;
+    }
+};
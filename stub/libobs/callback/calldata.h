@@ -0,0 +1,45 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// only string parameters are supported
+typedef struct calldata {
+    void *params;
+} calldata_t;
+
+void calldata_init(calldata_t *data);
+void calldata_free(calldata_t *data);
+void calldata_set_string(calldata_t *data, const char *name, const char *str);
+bool calldata_get_string(const calldata_t *data, const char *name, const char **str);
+
+static inline const char *calldata_string(const calldata_t *data, const char *name)
+{
+    const char *str = NULL;
+    calldata_get_string(data, name, &str);
+    return str;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "calldata.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct proc_handler proc_handler_t;
+typedef void (*proc_handler_proc_t)(void *, calldata_t *);
+
+// the name is taken from the declaration, parameters are not checked
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data);
+bool proc_handler_call(proc_handler_t *handler, const char *name, calldata_t *params);
+
+#ifdef __cplusplus
+}
+#endif
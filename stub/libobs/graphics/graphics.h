@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+
+typedef struct gs_effect gs_effect_t;
+typedef struct gs_effect_technique gs_technique_t;
+typedef struct gs_effect_param gs_eparam_t;
+typedef struct gs_vertex_buffer gs_vertbuffer_t;
+typedef struct gs_index_buffer gs_indexbuffer_t;
+
+enum gs_draw_mode {
+    GS_POINTS,
+    GS_LINES,
+    GS_LINESTRIP,
+    GS_TRIS,
+    GS_TRISTRIP
+};
+
+#define GS_BUILD_MIPMAPS (1 << 0)
+#define GS_DYNAMIC (1 << 1)
+
+struct gs_tvertarray {
+    size_t width;
+    void *array;
+};
+
+struct gs_vb_data {
+    size_t num;
+    struct vec3 *points;
+    struct vec3 *normals;
+    struct vec3 *tangents;
+    uint32_t *colors;
+    size_t num_tex;
+    struct gs_tvertarray *tvarray;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gs_vb_data *gs_vbdata_create(void);
+void gs_vbdata_destroy(struct gs_vb_data *data);
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data, uint32_t flags);
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer);
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer);
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer);
+
+gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string);
+void gs_effect_destroy(gs_effect_t *effect);
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect, const char *name);
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name);
+size_t gs_technique_begin(gs_technique_t *technique);
+void gs_technique_end(gs_technique_t *technique);
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass);
+void gs_technique_end_pass(gs_technique_t *technique);
+void gs_effect_set_float(gs_eparam_t *param, float val);
+void gs_effect_set_bool(gs_eparam_t *param, bool val);
+void gs_effect_set_vec2(gs_eparam_t *param, const struct vec2 *val);
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val);
+
+void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer);
+void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer);
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,38 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <xmmintrin.h>
+
+// same layout as libobs
+struct vec3 {
+    union {
+        struct {
+            float x, y, z, w;
+        };
+        float ptr[4];
+        __m128 m;
+    };
+};
+
+static inline void vec3_set(struct vec3 *dst, float x, float y, float z)
+{
+    dst->x = x;
+    dst->y = y;
+    dst->z = z;
+    dst->w = 0.0f;
+}
@@ -0,0 +1,87 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_AV_PLANES 8
+
+enum speaker_layout {
+    SPEAKERS_UNKNOWN,
+    SPEAKERS_MONO,
+    SPEAKERS_STEREO,
+    SPEAKERS_2POINT1,
+    SPEAKERS_4POINT0,
+    SPEAKERS_4POINT1,
+    SPEAKERS_5POINT1,
+    SPEAKERS_7POINT1 = 8
+};
+
+enum audio_format {
+    AUDIO_FORMAT_UNKNOWN,
+    AUDIO_FORMAT_U8BIT,
+    AUDIO_FORMAT_16BIT,
+    AUDIO_FORMAT_32BIT,
+    AUDIO_FORMAT_FLOAT,
+    AUDIO_FORMAT_U8BIT_PLANAR,
+    AUDIO_FORMAT_16BIT_PLANAR,
+    AUDIO_FORMAT_32BIT_PLANAR,
+    AUDIO_FORMAT_FLOAT_PLANAR
+};
+
+struct audio_data {
+    uint8_t *data[MAX_AV_PLANES];
+    uint32_t frames;
+    uint64_t timestamp;
+};
+
+struct audio_convert_info {
+    uint32_t samples_per_sec;
+    enum audio_format format;
+    enum speaker_layout speakers;
+    bool allow_clipping;
+};
+
+typedef struct audio_output audio_t;
+typedef void (*audio_output_callback_t)(void *param, size_t mix_idx, struct audio_data *data);
+
+static inline uint32_t get_audio_channels(enum speaker_layout speakers)
+{
+    switch(speakers)
+    {
+    case SPEAKERS_MONO: return 1;
+    case SPEAKERS_STEREO: return 2;
+    case SPEAKERS_2POINT1: return 3;
+    case SPEAKERS_4POINT0: return 4;
+    case SPEAKERS_4POINT1: return 5;
+    case SPEAKERS_5POINT1: return 6;
+    case SPEAKERS_7POINT1: return 8;
+    default: return 0;
+    }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool audio_output_connect(audio_t *audio, size_t mix_idx, const struct audio_convert_info *conversion, audio_output_callback_t callback, void *param);
+void audio_output_disconnect(audio_t *audio, size_t mix_idx, audio_output_callback_t callback, void *param);
+
+#ifdef __cplusplus
+}
+#endif
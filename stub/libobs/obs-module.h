@@ -0,0 +1,40 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#pragma once
+#include "obs.h"
+
+#ifdef __cplusplus
+#define MODULE_EXPORT extern "C"
+#else
+#define MODULE_EXPORT
+#endif
+
+// there is no module loader, the stub library provides the module functions itself
+#define OBS_DECLARE_MODULE()
+#define OBS_MODULE_USE_DEFAULT_LOCALE(module_name, default_locale)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *obs_module_text(const char *lookup_string);
+char *obs_module_file(const char *file);
+char *obs_module_config_path(const char *file);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// test hooks of the libobs stub
+// these replace the parts of OBS that would normally drive a source: audio sources, the output mix,
+// the video clock and the renderer
+
+#pragma once
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*obs_stub_draw_callback_t)(void *param, enum gs_draw_mode mode, const struct gs_vb_data *data, uint32_t start_vert, uint32_t num_verts);
+
+// defaults are 48kHz stereo at 60 FPS
+void obs_stub_set_audio_info(uint32_t samples_per_sec, enum speaker_layout speakers);
+void obs_stub_set_video_fps(uint32_t fps_num, uint32_t fps_den);
+void obs_stub_set_frame_time(uint64_t frame_time_ns);
+
+// messages above this level are dropped, default LOG_INFO
+void obs_stub_set_log_level(int log_level);
+
+// directory for obs_module_config_path(), NULL (the default) disables module config files
+void obs_stub_set_config_path(const char *path);
+
+// audio sources can be selected by name like any other OBS source and live until exit
+obs_source_t *obs_stub_create_audio_source(const char *name);
+
+// deliver planar float audio to capture callbacks, as the audio thread would
+void obs_stub_push_source_audio(obs_source_t *source, const float *const *planes, uint32_t frames, bool muted);
+void obs_stub_push_output_audio(const float *const *planes, uint32_t frames);
+
+// the obs_source_info most recently registered with this id, NULL if none
+const struct obs_source_info *obs_stub_find_source_info(const char *id);
+
+// called for every gs_draw() with the vertex buffer that is currently loaded
+void obs_stub_set_draw_callback(obs_stub_draw_callback_t callback, void *param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,171 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+// minimal subset of the libobs API used by waveform, enough to link and run it headless
+// see obs-stub.h for feeding audio and inspecting draws
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "util/base.h"
+#include "util/bmem.h"
+#include "graphics/graphics.h"
+#include "media-io/audio-io.h"
+#include "callback/proc.h"
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_weak_source obs_weak_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+
+struct obs_audio_info {
+    uint32_t samples_per_sec;
+    enum speaker_layout speakers;
+};
+
+struct obs_video_info {
+    const char *graphics_module;
+    uint32_t fps_num;
+    uint32_t fps_den;
+    uint32_t base_width;
+    uint32_t base_height;
+    uint32_t output_width;
+    uint32_t output_height;
+};
+
+enum obs_source_type {
+    OBS_SOURCE_TYPE_INPUT,
+    OBS_SOURCE_TYPE_FILTER,
+    OBS_SOURCE_TYPE_TRANSITION,
+    OBS_SOURCE_TYPE_SCENE
+};
+
+enum obs_icon_type {
+    OBS_ICON_TYPE_UNKNOWN,
+    OBS_ICON_TYPE_AUDIO_OUTPUT = 11
+};
+
+enum obs_combo_type {
+    OBS_COMBO_TYPE_INVALID,
+    OBS_COMBO_TYPE_EDITABLE,
+    OBS_COMBO_TYPE_LIST
+};
+
+enum obs_combo_format {
+    OBS_COMBO_FORMAT_INVALID,
+    OBS_COMBO_FORMAT_INT,
+    OBS_COMBO_FORMAT_FLOAT,
+    OBS_COMBO_FORMAT_STRING
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+#define OBS_SOURCE_ASYNC (1 << 2)
+#define OBS_SOURCE_CUSTOM_DRAW (1 << 3)
+
+typedef bool (*obs_property_modified_t)(obs_properties_t *props, obs_property_t *property, obs_data_t *settings);
+typedef void (*obs_source_audio_capture_t)(void *param, obs_source_t *source, const struct audio_data *audio_data, bool muted);
+
+struct obs_source_info {
+    const char *id;
+    enum obs_source_type type;
+    uint32_t output_flags;
+    const char *(*get_name)(void *type_data);
+    void *(*create)(obs_data_t *settings, obs_source_t *source);
+    void (*destroy)(void *data);
+    uint32_t (*get_width)(void *data);
+    uint32_t (*get_height)(void *data);
+    void (*get_defaults)(obs_data_t *settings);
+    obs_properties_t *(*get_properties)(void *data);
+    void (*update)(void *data, obs_data_t *settings);
+    void (*activate)(void *data);
+    void (*deactivate)(void *data);
+    void (*show)(void *data);
+    void (*hide)(void *data);
+    void (*video_tick)(void *data, float seconds);
+    void (*video_render)(void *data, gs_effect_t *effect);
+    enum obs_icon_type icon_type;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void obs_register_source(const struct obs_source_info *info);
+
+bool obs_get_audio_info(struct obs_audio_info *oai);
+bool obs_get_video_info(struct obs_video_info *ovi);
+audio_t *obs_get_audio(void);
+uint64_t obs_get_video_frame_time(void);
+
+void obs_enter_graphics(void);
+void obs_leave_graphics(void);
+
+// sources
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param);
+obs_source_t *obs_get_source_by_name(const char *name);
+void obs_source_release(obs_source_t *source);
+uint32_t obs_source_get_output_flags(const obs_source_t *source);
+const char *obs_source_get_name(const obs_source_t *source);
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source);
+obs_weak_source_t *obs_source_get_weak_source(obs_source_t *source);
+obs_source_t *obs_weak_source_get_source(obs_weak_source_t *weak);
+void obs_weak_source_release(obs_weak_source_t *weak);
+void obs_source_add_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param);
+void obs_source_remove_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param);
+
+// settings
+obs_data_t *obs_data_create(void);
+void obs_data_release(obs_data_t *data);
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+double obs_data_get_double(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+
+// properties, only names and visibility are tracked
+obs_properties_t *obs_properties_create(void);
+void obs_properties_destroy(obs_properties_t *props);
+obs_property_t *obs_properties_get(obs_properties_t *props, const char *property);
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description);
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description, int min, int max, int step);
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name, const char *description, int min, int max, int step);
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props, const char *name, const char *description, double min, double max, double step);
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description, enum obs_combo_type type, enum obs_combo_format format);
+obs_property_t *obs_properties_add_color(obs_properties_t *props, const char *name, const char *description);
+obs_property_t *obs_properties_add_color_alpha(obs_properties_t *props, const char *name, const char *description);
+size_t obs_property_list_add_string(obs_property_t *p, const char *name, const char *val);
+void obs_property_list_item_disable(obs_property_t *p, size_t idx, bool disabled);
+void obs_property_set_modified_callback(obs_property_t *p, obs_property_modified_t modified);
+void obs_property_set_long_description(obs_property_t *p, const char *long_description);
+void obs_property_set_visible(obs_property_t *p, bool visible);
+void obs_property_set_enabled(obs_property_t *p, bool enabled);
+bool obs_property_visible(obs_property_t *p);
+void obs_property_int_set_suffix(obs_property_t *p, const char *suffix);
+void obs_property_float_set_suffix(obs_property_t *p, const char *suffix);
+
+#ifdef __cplusplus
+}
+#endif
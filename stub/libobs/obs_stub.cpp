@@ -0,0 +1,862 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "obs-module.h"
+#include "obs-stub.h"
+#include "util/platform.h"
+#include "util/profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct CaptureCallback
+    {
+        void *cb;
+        void *param;
+    };
+
+    struct Settings
+    {
+        std::map<std::string, std::string> strings;
+        std::map<std::string, long long> ints;
+        std::map<std::string, double> doubles;
+        std::map<std::string, bool> bools;
+    };
+
+    bool lookup_bool(const Settings& settings, const char *name, bool& val)
+    {
+        auto it = settings.bools.find(name);
+        if(it == settings.bools.end())
+            return false;
+        val = it->second;
+        return true;
+    }
+
+    // like libobs, ints and doubles are both numbers and either getter converts
+    template<typename T>
+    bool lookup_number(const Settings& settings, const char *name, T& val)
+    {
+        auto iti = settings.ints.find(name);
+        if(iti != settings.ints.end())
+        {
+            val = (T)iti->second;
+            return true;
+        }
+        auto itd = settings.doubles.find(name);
+        if(itd != settings.doubles.end())
+        {
+            val = (T)itd->second;
+            return true;
+        }
+        return false;
+    }
+
+    struct State
+    {
+        std::mutex mtx;
+        std::recursive_mutex graphics_mtx;
+        std::atomic_int log_level = LOG_INFO;
+        obs_audio_info audio_info{ 48000, SPEAKERS_STEREO };
+        uint32_t fps_num = 60;
+        uint32_t fps_den = 1;
+        std::atomic<uint64_t> frame_time = 0;
+        std::string config_path;
+        std::vector<std::unique_ptr<obs_source>> sources;
+        std::map<std::string, obs_source_info> source_infos;
+
+        std::mutex output_mtx;
+        std::vector<CaptureCallback> output_callbacks;
+
+        gs_vertbuffer_t *vertbuffer = nullptr;
+        obs_stub_draw_callback_t draw_callback = nullptr;
+        void *draw_param = nullptr;
+    };
+
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    char *copy_string(const std::string& str)
+    {
+        auto ret = (char*)bmalloc(str.size() + 1);
+        memcpy(ret, str.c_str(), str.size() + 1);
+        return ret;
+    }
+}
+
+struct proc_handler
+{
+    struct Proc
+    {
+        std::string name;
+        proc_handler_proc_t proc;
+        void *data;
+    };
+
+    std::mutex mtx;
+    std::vector<Proc> procs;
+};
+
+struct obs_source
+{
+    std::string name;
+    std::mutex mtx;
+    std::vector<CaptureCallback> callbacks;
+    proc_handler procs;
+};
+
+// weak references are the source itself, sources are never destroyed
+struct obs_weak_source
+{
+};
+
+struct obs_data
+{
+    Settings values;
+    Settings defaults;
+};
+
+struct obs_property
+{
+    std::string name;
+    bool visible = true;
+    bool enabled = true;
+    size_t items = 0;
+};
+
+struct obs_properties
+{
+    std::vector<std::unique_ptr<obs_property>> props;
+};
+
+struct audio_output
+{
+};
+
+struct gs_vertex_buffer
+{
+    gs_vb_data *data;
+};
+
+struct gs_effect
+{
+};
+
+struct gs_effect_technique
+{
+};
+
+struct gs_effect_param
+{
+};
+
+static audio_output stub_output;
+static gs_effect_technique stub_technique;
+static gs_effect_param stub_param;
+
+static uint32_t audio_channels()
+{
+    std::lock_guard lock(state().mtx);
+    return get_audio_channels(state().audio_info.speakers);
+}
+
+static obs_property_t *add_property(obs_properties_t *props, const char *name)
+{
+    props->props.push_back(std::make_unique<obs_property>());
+    props->props.back()->name = name;
+    return props->props.back().get();
+}
+
+extern "C" {
+
+// logging and memory
+void blog(int log_level, const char *format, ...)
+{
+    if(log_level > state().log_level)
+        return;
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void *bmalloc(size_t size)
+{
+    auto ret = malloc((size > 0) ? size : 1);
+    if(ret == nullptr)
+        abort();
+    return ret;
+}
+
+void *bzalloc(size_t size)
+{
+    auto ret = bmalloc(size);
+    memset(ret, 0, size);
+    return ret;
+}
+
+void bfree(void *ptr)
+{
+    free(ptr);
+}
+
+char *bstrdup(const char *str)
+{
+    return (str != nullptr) ? copy_string(str) : nullptr;
+}
+
+uint64_t os_gettime_ns(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int os_mkdirs(const char *path)
+{
+    std::error_code err;
+    if(std::filesystem::is_directory(path, err))
+        return MKDIR_EXISTS;
+    return std::filesystem::create_directories(path, err) ? MKDIR_SUCCESS : MKDIR_ERROR;
+}
+
+bool os_file_exists(const char *path)
+{
+    std::error_code err;
+    return std::filesystem::exists(path, err);
+}
+
+// profiler
+void profile_register_root([[maybe_unused]] const char *name, [[maybe_unused]] uint64_t expected_time_between_calls)
+{
+}
+
+void profile_start([[maybe_unused]] const char *name)
+{
+}
+
+void profile_end([[maybe_unused]] const char *name)
+{
+}
+
+// calldata and procs
+void calldata_init(calldata_t *data)
+{
+    data->params = new std::map<std::string, std::string>();
+}
+
+void calldata_free(calldata_t *data)
+{
+    delete static_cast<std::map<std::string, std::string>*>(data->params);
+    data->params = nullptr;
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+    (*static_cast<std::map<std::string, std::string>*>(data->params))[name] = (str != nullptr) ? str : "";
+}
+
+bool calldata_get_string(const calldata_t *data, const char *name, const char **str)
+{
+    auto params = static_cast<const std::map<std::string, std::string>*>(data->params);
+    auto it = params->find(name);
+    if(it == params->end())
+        return false;
+    *str = it->second.c_str();
+    return true;
+}
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data)
+{
+    // "void name(...)"
+    std::string decl = decl_string;
+    auto start = decl.find(' ');
+    start = (start == std::string::npos) ? 0 : start + 1;
+    auto name = decl.substr(start, decl.find('(') - start);
+
+    std::lock_guard lock(handler->mtx);
+    handler->procs.push_back({ name, proc, data });
+}
+
+bool proc_handler_call(proc_handler_t *handler, const char *name, calldata_t *params)
+{
+    proc_handler::Proc proc{};
+    {
+        std::lock_guard lock(handler->mtx);
+        for(const auto& i : handler->procs)
+            if(i.name == name)
+                proc = i;
+    }
+    if(proc.proc == nullptr)
+        return false;
+    proc.proc(proc.data, params);
+    return true;
+}
+
+// module
+const char *obs_module_text(const char *lookup_string)
+{
+    return lookup_string;
+}
+
+char *obs_module_file(const char *file)
+{
+    return bstrdup(file);
+}
+
+char *obs_module_config_path(const char *file)
+{
+    std::lock_guard lock(state().mtx);
+    if(state().config_path.empty())
+        return nullptr;
+    return copy_string(state().config_path + "/" + file);
+}
+
+void obs_register_source(const struct obs_source_info *info)
+{
+    std::lock_guard lock(state().mtx);
+    state().source_infos[info->id] = *info;
+}
+
+// core
+bool obs_get_audio_info(struct obs_audio_info *oai)
+{
+    std::lock_guard lock(state().mtx);
+    *oai = state().audio_info;
+    return true;
+}
+
+bool obs_get_video_info(struct obs_video_info *ovi)
+{
+    std::lock_guard lock(state().mtx);
+    *ovi = {};
+    ovi->graphics_module = "stub";
+    ovi->fps_num = state().fps_num;
+    ovi->fps_den = state().fps_den;
+    return true;
+}
+
+audio_t *obs_get_audio(void)
+{
+    return &stub_output;
+}
+
+uint64_t obs_get_video_frame_time(void)
+{
+    return state().frame_time;
+}
+
+void obs_enter_graphics(void)
+{
+    state().graphics_mtx.lock();
+}
+
+void obs_leave_graphics(void)
+{
+    state().graphics_mtx.unlock();
+}
+
+// sources
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+    std::vector<obs_source_t*> sources;
+    {
+        std::lock_guard lock(state().mtx);
+        for(auto& i : state().sources)
+            sources.push_back(i.get());
+    }
+    for(auto i : sources)
+        if(!enum_proc(param, i))
+            break;
+}
+
+obs_source_t *obs_get_source_by_name(const char *name)
+{
+    std::lock_guard lock(state().mtx);
+    for(auto& i : state().sources)
+        if(i->name == name)
+            return i.get();
+    return nullptr;
+}
+
+void obs_source_release([[maybe_unused]] obs_source_t *source)
+{
+}
+
+uint32_t obs_source_get_output_flags([[maybe_unused]] const obs_source_t *source)
+{
+    return OBS_SOURCE_AUDIO;
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+    return source->name.c_str();
+}
+
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
+{
+    return const_cast<proc_handler_t*>(&source->procs);
+}
+
+obs_weak_source_t *obs_source_get_weak_source(obs_source_t *source)
+{
+    return reinterpret_cast<obs_weak_source_t*>(source);
+}
+
+obs_source_t *obs_weak_source_get_source(obs_weak_source_t *weak)
+{
+    return reinterpret_cast<obs_source_t*>(weak);
+}
+
+void obs_weak_source_release([[maybe_unused]] obs_weak_source_t *weak)
+{
+}
+
+void obs_source_add_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param)
+{
+    std::lock_guard lock(source->mtx);
+    source->callbacks.push_back({ (void*)callback, param });
+}
+
+void obs_source_remove_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param)
+{
+    std::lock_guard lock(source->mtx);
+    auto& cbs = source->callbacks;
+    for(auto it = cbs.begin(); it != cbs.end(); ++it)
+    {
+        if((it->cb == (void*)callback) && (it->param == param))
+        {
+            cbs.erase(it);
+            break;
+        }
+    }
+}
+
+bool audio_output_connect([[maybe_unused]] audio_t *audio, [[maybe_unused]] size_t mix_idx, [[maybe_unused]] const struct audio_convert_info *conversion, audio_output_callback_t callback, void *param)
+{
+    std::lock_guard lock(state().output_mtx);
+    state().output_callbacks.push_back({ (void*)callback, param });
+    return true;
+}
+
+void audio_output_disconnect([[maybe_unused]] audio_t *audio, [[maybe_unused]] size_t mix_idx, audio_output_callback_t callback, void *param)
+{
+    std::lock_guard lock(state().output_mtx);
+    auto& cbs = state().output_callbacks;
+    for(auto it = cbs.begin(); it != cbs.end(); ++it)
+    {
+        if((it->cb == (void*)callback) && (it->param == param))
+        {
+            cbs.erase(it);
+            break;
+        }
+    }
+}
+
+// settings
+obs_data_t *obs_data_create(void)
+{
+    return new obs_data;
+}
+
+void obs_data_release(obs_data_t *data)
+{
+    delete data;
+}
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+    data->values.strings[name] = val;
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+    data->values.doubles.erase(name);
+    data->values.ints[name] = val;
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+    data->values.ints.erase(name);
+    data->values.doubles[name] = val;
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+    data->values.bools[name] = val;
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val)
+{
+    data->defaults.strings[name] = val;
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val)
+{
+    data->defaults.doubles.erase(name);
+    data->defaults.ints[name] = val;
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val)
+{
+    data->defaults.ints.erase(name);
+    data->defaults.doubles[name] = val;
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+    data->defaults.bools[name] = val;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+    auto it = data->values.strings.find(name);
+    if(it != data->values.strings.end())
+        return it->second.c_str();
+    it = data->defaults.strings.find(name);
+    return (it != data->defaults.strings.end()) ? it->second.c_str() : "";
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+    long long val = 0;
+    if(!lookup_number(data->values, name, val))
+        lookup_number(data->defaults, name, val);
+    return val;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+    double val = 0.0;
+    if(!lookup_number(data->values, name, val))
+        lookup_number(data->defaults, name, val);
+    return val;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+    bool val = false;
+    if(!lookup_bool(data->values, name, val))
+        lookup_bool(data->defaults, name, val);
+    return val;
+}
+
+// properties
+obs_properties_t *obs_properties_create(void)
+{
+    return new obs_properties;
+}
+
+void obs_properties_destroy(obs_properties_t *props)
+{
+    delete props;
+}
+
+obs_property_t *obs_properties_get(obs_properties_t *props, const char *property)
+{
+    for(auto& i : props->props)
+        if(i->name == property)
+            return i.get();
+    return nullptr;
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description, [[maybe_unused]] int min, [[maybe_unused]] int max, [[maybe_unused]] int step)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description, [[maybe_unused]] int min, [[maybe_unused]] int max, [[maybe_unused]] int step)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description, [[maybe_unused]] double min, [[maybe_unused]] double max, [[maybe_unused]] double step)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description, [[maybe_unused]] enum obs_combo_type type, [[maybe_unused]] enum obs_combo_format format)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_color(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description)
+{
+    return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_color_alpha(obs_properties_t *props, const char *name, [[maybe_unused]] const char *description)
+{
+    return add_property(props, name);
+}
+
+size_t obs_property_list_add_string(obs_property_t *p, [[maybe_unused]] const char *name, [[maybe_unused]] const char *val)
+{
+    return p->items++;
+}
+
+void obs_property_list_item_disable([[maybe_unused]] obs_property_t *p, [[maybe_unused]] size_t idx, [[maybe_unused]] bool disabled)
+{
+}
+
+void obs_property_set_modified_callback([[maybe_unused]] obs_property_t *p, [[maybe_unused]] obs_property_modified_t modified)
+{
+}
+
+void obs_property_set_long_description([[maybe_unused]] obs_property_t *p, [[maybe_unused]] const char *long_description)
+{
+}
+
+void obs_property_set_visible(obs_property_t *p, bool visible)
+{
+    if(p != nullptr)
+        p->visible = visible;
+}
+
+void obs_property_set_enabled(obs_property_t *p, bool enabled)
+{
+    if(p != nullptr)
+        p->enabled = enabled;
+}
+
+bool obs_property_visible(obs_property_t *p)
+{
+    return (p != nullptr) && p->visible;
+}
+
+void obs_property_int_set_suffix([[maybe_unused]] obs_property_t *p, [[maybe_unused]] const char *suffix)
+{
+}
+
+void obs_property_float_set_suffix([[maybe_unused]] obs_property_t *p, [[maybe_unused]] const char *suffix)
+{
+}
+
+// graphics
+struct gs_vb_data *gs_vbdata_create(void)
+{
+    return (gs_vb_data*)bzalloc(sizeof(gs_vb_data));
+}
+
+void gs_vbdata_destroy(struct gs_vb_data *data)
+{
+    if(data == nullptr)
+        return;
+    bfree(data->points);
+    bfree(data->normals);
+    bfree(data->tangents);
+    bfree(data->colors);
+    for(size_t i = 0; (data->tvarray != nullptr) && (i < data->num_tex); ++i)
+        bfree(data->tvarray[i].array);
+    bfree(data->tvarray);
+    bfree(data);
+}
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data, [[maybe_unused]] uint32_t flags)
+{
+    return new gs_vertex_buffer{ data };
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
+{
+    if(vertbuffer == nullptr)
+        return;
+    gs_vbdata_destroy(vertbuffer->data);
+    delete vertbuffer;
+}
+
+void gs_vertexbuffer_flush([[maybe_unused]] gs_vertbuffer_t *vertbuffer)
+{
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
+{
+    return vertbuffer->data;
+}
+
+gs_effect_t *gs_effect_create_from_file([[maybe_unused]] const char *file, char **error_string)
+{
+    if(error_string != nullptr)
+        *error_string = nullptr;
+    return new gs_effect;
+}
+
+void gs_effect_destroy(gs_effect_t *effect)
+{
+    delete effect;
+}
+
+gs_technique_t *gs_effect_get_technique([[maybe_unused]] const gs_effect_t *effect, [[maybe_unused]] const char *name)
+{
+    return &stub_technique;
+}
+
+gs_eparam_t *gs_effect_get_param_by_name([[maybe_unused]] const gs_effect_t *effect, [[maybe_unused]] const char *name)
+{
+    return &stub_param;
+}
+
+size_t gs_technique_begin([[maybe_unused]] gs_technique_t *technique)
+{
+    return 1;
+}
+
+void gs_technique_end([[maybe_unused]] gs_technique_t *technique)
+{
+}
+
+bool gs_technique_begin_pass([[maybe_unused]] gs_technique_t *technique, [[maybe_unused]] size_t pass)
+{
+    return true;
+}
+
+void gs_technique_end_pass([[maybe_unused]] gs_technique_t *technique)
+{
+}
+
+void gs_effect_set_float([[maybe_unused]] gs_eparam_t *param, [[maybe_unused]] float val)
+{
+}
+
+void gs_effect_set_bool([[maybe_unused]] gs_eparam_t *param, [[maybe_unused]] bool val)
+{
+}
+
+void gs_effect_set_vec2([[maybe_unused]] gs_eparam_t *param, [[maybe_unused]] const struct vec2 *val)
+{
+}
+
+void gs_effect_set_vec4([[maybe_unused]] gs_eparam_t *param, [[maybe_unused]] const struct vec4 *val)
+{
+}
+
+void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer)
+{
+    state().vertbuffer = vertbuffer;
+}
+
+void gs_load_indexbuffer([[maybe_unused]] gs_indexbuffer_t *indexbuffer)
+{
+}
+
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert, uint32_t num_verts)
+{
+    auto& s = state();
+    if((s.draw_callback != nullptr) && (s.vertbuffer != nullptr))
+        s.draw_callback(s.draw_param, draw_mode, s.vertbuffer->data, start_vert, num_verts);
+}
+
+// test hooks
+void obs_stub_set_audio_info(uint32_t samples_per_sec, enum speaker_layout speakers)
+{
+    std::lock_guard lock(state().mtx);
+    state().audio_info = { samples_per_sec, speakers };
+}
+
+void obs_stub_set_video_fps(uint32_t fps_num, uint32_t fps_den)
+{
+    std::lock_guard lock(state().mtx);
+    state().fps_num = fps_num;
+    state().fps_den = fps_den;
+}
+
+void obs_stub_set_frame_time(uint64_t frame_time_ns)
+{
+    state().frame_time = frame_time_ns;
+}
+
+void obs_stub_set_log_level(int log_level)
+{
+    state().log_level = log_level;
+}
+
+void obs_stub_set_config_path(const char *path)
+{
+    std::lock_guard lock(state().mtx);
+    state().config_path = (path != nullptr) ? path : "";
+}
+
+obs_source_t *obs_stub_create_audio_source(const char *name)
+{
+    std::lock_guard lock(state().mtx);
+    for(auto& i : state().sources)
+        if(i->name == name)
+            return i.get();
+    state().sources.push_back(std::make_unique<obs_source>());
+    state().sources.back()->name = name;
+    return state().sources.back().get();
+}
+
+void obs_stub_push_source_audio(obs_source_t *source, const float *const *planes, uint32_t frames, bool muted)
+{
+    audio_data audio{};
+    for(auto i = 0u; i < audio_channels(); ++i)
+        audio.data[i] = (uint8_t*)planes[i];
+    audio.frames = frames;
+    audio.timestamp = os_gettime_ns();
+
+    // callbacks run under the source lock, like the OBS audio thread
+    std::lock_guard lock(source->mtx);
+    for(const auto& i : source->callbacks)
+        ((obs_source_audio_capture_t)i.cb)(i.param, source, &audio, muted);
+}
+
+void obs_stub_push_output_audio(const float *const *planes, uint32_t frames)
+{
+    audio_data audio{};
+    for(auto i = 0u; i < audio_channels(); ++i)
+        audio.data[i] = (uint8_t*)planes[i];
+    audio.frames = frames;
+    audio.timestamp = os_gettime_ns();
+
+    std::lock_guard lock(state().output_mtx);
+    for(const auto& i : state().output_callbacks)
+        ((audio_output_callback_t)i.cb)(i.param, 0, &audio);
+}
+
+const struct obs_source_info *obs_stub_find_source_info(const char *id)
+{
+    std::lock_guard lock(state().mtx);
+    auto it = state().source_infos.find(id);
+    return (it != state().source_infos.end()) ? &it->second : nullptr;
+}
+
+void obs_stub_set_draw_callback(obs_stub_draw_callback_t callback, void *param)
+{
+    obs_enter_graphics();
+    state().draw_callback = callback;
+    state().draw_param = param;
+    obs_leave_graphics();
+}
+
+}
@@ -0,0 +1,756 @@
+/*
+    Copyright (C) 2022 Devin Davila
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// runs audio files through the same analysis path as the source, as fast as possible
+// audio is fed in video frame sized chunks through the libobs stub and the spectrum is read back after every tick
+
+#include "source.hpp"
+#include "settings.hpp"
+#include "fft_planner.hpp"
+#include "simd_math.hpp"
+#include <obs-stub.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char *USAGE =
+    "usage: waveform-cli [options] [--<setting> <value>...] <input>\n"
+    "       waveform-cli --check-isa [options] [--<setting> <value>...] [input]\n"
+    "\n"
+    "options:\n"
+    "  -o, --output <file>     write spectra to file instead of stdout\n"
+    "  --format <csv|f32>      csv: \"frame,channel,values...\" per line (default)\n"
+    "                          f32: native float32, channels interleaved per frame\n"
+    "  --bins                  output dBFS per FFT bin instead of the interpolated display values\n"
+    "                          (covers every bin, the cutoffs are ignored)\n"
+    "  --fps <n>               video frames per second (default 60)\n"
+    "  --isa <avx2|avx|sse2|scalar>\n"
+    "                          force an instruction set for the source (default best available)\n"
+    "  --check-isa             compare every supported instruction set against the scalar reference\n"
+    "                          over all windows, smoothing, slope, hop, channel, domain and interpolation\n"
+    "                          modes instead of writing spectra, the input is optional (a synthetic\n"
+    "                          signal is used), the dBFS kernels are also checked against log10\n"
+    "  --tolerance <dB>        largest per-bin difference --check-isa accepts (default 0.001)\n"
+    "  --raw <s16|s32|f32>     input is headerless interleaved PCM in the given format\n"
+    "  --rate <hz>             sample rate of raw input (default 48000)\n"
+    "  --channels <n>          channel count of raw input (default 2)\n"
+    "  -q, --quiet             don't print the summary\n"
+    "\n"
+    "settings use the source's setting keys, e.g. --fft_size 4096 --window blackman --temporal_smoothing none\n"
+    "true/false set booleans, numbers set numbers and anything else sets a string\n"
+    "auto_fft_size and analysis_thread are always off, audio_source is always the input file\n";
+
+namespace {
+    constexpr auto AUDIO_SOURCE = "waveform-cli";
+
+    struct Audio
+    {
+        uint32_t sample_rate = 0;
+        std::vector<std::vector<float>> channels; // planar
+    };
+
+    enum class SampleFormat
+    {
+        U8,
+        S16,
+        S24,
+        S32,
+        F32,
+        F64
+    };
+
+    bool parse_format(const std::string& str, SampleFormat& fmt)
+    {
+        if(str == "s16")
+            fmt = SampleFormat::S16;
+        else if(str == "s32")
+            fmt = SampleFormat::S32;
+        else if(str == "f32")
+            fmt = SampleFormat::F32;
+        else
+            return false;
+        return true;
+    }
+
+    size_t sample_bytes(SampleFormat fmt)
+    {
+        switch(fmt)
+        {
+        case SampleFormat::U8: return 1;
+        case SampleFormat::S16: return 2;
+        case SampleFormat::S24: return 3;
+        case SampleFormat::S32: return 4;
+        case SampleFormat::F32: return 4;
+        default: return 8;
+        }
+    }
+
+    // little endian interleaved samples -> planar float
+    void decode(const uint8_t *data, size_t frames, uint32_t num_channels, SampleFormat fmt, Audio& audio)
+    {
+        const auto bytes = sample_bytes(fmt);
+        audio.channels.assign(num_channels, std::vector<float>(frames));
+        for(size_t i = 0; i < frames; ++i)
+        {
+            for(auto ch = 0u; ch < num_channels; ++ch)
+            {
+                const auto p = &data[((i * num_channels) + ch) * bytes];
+                float val;
+                switch(fmt)
+                {
+                case SampleFormat::U8:
+                    val = ((float)p[0] - 128.0f) / 128.0f;
+                    break;
+                case SampleFormat::S16:
+                    val = (float)(int16_t)(p[0] | (p[1] << 8)) / 32768.0f;
+                    break;
+                case SampleFormat::S24:
+                    val = (float)((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8) / 8388608.0f;
+                    break;
+                case SampleFormat::S32:
+                    val = (float)((double)(int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24) / 2147483648.0);
+                    break;
+                case SampleFormat::F32:
+                    memcpy(&val, p, sizeof(float));
+                    break;
+                default:
+                {
+                    double d;
+                    memcpy(&d, p, sizeof(double));
+                    val = (float)d;
+                    break;
+                }
+                }
+                audio.channels[ch][i] = val;
+            }
+        }
+    }
+
+    bool read_file(const char *path, std::vector<uint8_t>& data)
+    {
+        auto file = std::fopen(path, "rb");
+        if(file == nullptr)
+            return false;
+        uint8_t buf[65536];
+        size_t n;
+        while((n = std::fread(buf, 1, sizeof(buf), file)) > 0)
+            data.insert(data.end(), buf, buf + n);
+        std::fclose(file);
+        return true;
+    }
+
+    uint16_t read_u16(const uint8_t *p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    uint32_t read_u32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // RIFF WAVE with PCM or IEEE float samples, including WAVE_FORMAT_EXTENSIBLE
+    bool parse_wav(const std::vector<uint8_t>& data, Audio& audio, std::string& error)
+    {
+        if((data.size() < 12) || (memcmp(data.data(), "RIFF", 4) != 0) || (memcmp(&data[8], "WAVE", 4) != 0))
+        {
+            error = "not a RIFF WAVE file (use --raw for headerless PCM)";
+            return false;
+        }
+
+        uint16_t format = 0;
+        uint16_t num_channels = 0;
+        uint16_t bits = 0;
+        const uint8_t *samples = nullptr;
+        size_t samples_size = 0;
+        for(size_t pos = 12; pos + 8 <= data.size();)
+        {
+            const auto id = &data[pos];
+            const auto size = std::min<size_t>(read_u32(&data[pos + 4]), data.size() - pos - 8);
+            const auto chunk = &data[pos + 8];
+            if((memcmp(id, "fmt ", 4) == 0) && (size >= 16))
+            {
+                format = read_u16(chunk);
+                num_channels = read_u16(&chunk[2]);
+                audio.sample_rate = read_u32(&chunk[4]);
+                bits = read_u16(&chunk[14]);
+                if((format == 0xfffe) && (size >= 26))
+                    format = read_u16(&chunk[24]); // first two bytes of the sub-format GUID
+            }
+            else if(memcmp(id, "data", 4) == 0)
+            {
+                samples = chunk;
+                samples_size = size;
+            }
+            pos += 8 + size + (size & 1);
+        }
+
+        if((samples == nullptr) || (num_channels == 0) || (audio.sample_rate == 0))
+        {
+            error = "missing fmt or data chunk";
+            return false;
+        }
+
+        SampleFormat fmt;
+        if((format == 1) && (bits == 8))
+            fmt = SampleFormat::U8;
+        else if((format == 1) && (bits == 16))
+            fmt = SampleFormat::S16;
+        else if((format == 1) && (bits == 24))
+            fmt = SampleFormat::S24;
+        else if((format == 1) && (bits == 32))
+            fmt = SampleFormat::S32;
+        else if((format == 3) && (bits == 32))
+            fmt = SampleFormat::F32;
+        else if((format == 3) && (bits == 64))
+            fmt = SampleFormat::F64;
+        else
+        {
+            error = "unsupported sample format " + std::to_string(format) + " with " + std::to_string(bits) + " bits";
+            return false;
+        }
+
+        decode(samples, samples_size / (sample_bytes(fmt) * num_channels), num_channels, fmt, audio);
+        return true;
+    }
+
+    speaker_layout layout_for(size_t channels)
+    {
+        switch(channels)
+        {
+        case 1: return SPEAKERS_MONO;
+        case 2: return SPEAKERS_STEREO;
+        case 3: return SPEAKERS_2POINT1;
+        case 4: return SPEAKERS_4POINT0;
+        case 5: return SPEAKERS_4POINT1;
+        case 6: return SPEAKERS_5POINT1;
+        case 8: return SPEAKERS_7POINT1;
+        default: return SPEAKERS_UNKNOWN;
+        }
+    }
+
+    // --key value for the source settings
+    void apply_setting(obs_data_t *settings, const char *key, const char *value)
+    {
+        char *end = nullptr;
+        if((strcmp(value, "true") == 0) || (strcmp(value, "false") == 0))
+            obs_data_set_bool(settings, key, strcmp(value, "true") == 0);
+        else if(auto i = std::strtoll(value, &end, 0); (end != value) && (*end == '\0'))
+            obs_data_set_int(settings, key, i);
+        else if(auto d = std::strtod(value, &end); (end != value) && (*end == '\0'))
+            obs_data_set_double(settings, key, d);
+        else
+            obs_data_set_string(settings, key, value);
+    }
+
+    // nullptr if the CPU doesn't support it
+    std::unique_ptr<WAVSource> create_source(const std::string& isa, obs_data_t *settings)
+    {
+        if((isa == "avx2") && WAVSource::HAVE_AVX2)
+            return std::make_unique<WAVSourceAVX2>(settings, nullptr);
+        else if((isa == "avx") && WAVSource::HAVE_AVX)
+            return std::make_unique<WAVSourceAVX>(settings, nullptr);
+        else if(isa == "sse2")
+            return std::make_unique<WAVSourceSSE2>(settings, nullptr);
+        else if(isa == "scalar")
+            return std::make_unique<WAVSourceScalar>(settings, nullptr);
+        return nullptr;
+    }
+
+    // two seconds of tones, a sweep and noise with a silent gap, so the smoothing has something to decay
+    Audio synthetic_audio(uint32_t channels)
+    {
+        constexpr uint32_t rate = 48000;
+        Audio audio;
+        audio.sample_rate = rate;
+        audio.channels.assign(channels, std::vector<float>(rate * 2));
+        uint32_t noise = 1;
+        for(auto ch = 0u; ch < channels; ++ch)
+        {
+            const auto tone = 440.0 * (ch + 1);
+            for(auto i = 0u; i < rate * 2; ++i)
+            {
+                const auto t = (double)i / rate;
+                if((t >= 1.0) && (t < 1.25))
+                    continue;
+                noise = (noise * 1664525u) + 1013904223u;
+                const auto sweep = 2 * M_PI * (50.0 * t + (5000.0 * t * t));
+                const auto val = (0.5 * std::sin(2 * M_PI * tone * t)) + (0.25 * std::sin(sweep)) + (0.01 * (((double)noise / UINT32_MAX) - 0.5));
+                audio.channels[ch][i] = (float)(val * std::min(t * 4.0, 1.0));
+            }
+        }
+        return audio;
+    }
+
+    // the dbfs_* kernels over a buffer, count is a multiple of 8
+    DECORATE_AVX2
+    void dbfs_buffer_avx2(const float *in, float *out, size_t count, float db_per_ln)
+    {
+        for(size_t i = 0; i < count; i += 8)
+            _mm256_storeu_ps(&out[i], dbfs_avx2(_mm256_loadu_ps(&in[i]), db_per_ln));
+    }
+
+    DECORATE_AVX
+    void dbfs_buffer_avx(const float *in, float *out, size_t count, float db_per_ln)
+    {
+        for(size_t i = 0; i < count; i += 8)
+            _mm256_storeu_ps(&out[i], dbfs_avx(_mm256_loadu_ps(&in[i]), db_per_ln));
+    }
+
+    DECORATE_SSE2
+    void dbfs_buffer_sse2(const float *in, float *out, size_t count, float db_per_ln)
+    {
+        for(size_t i = 0; i < count; i += 4)
+            _mm_storeu_ps(&out[i], dbfs_sse2(_mm_loadu_ps(&in[i]), db_per_ln));
+    }
+
+    float float_from_bits(uint32_t bits)
+    {
+        float val;
+        std::memcpy(&val, &bits, sizeof(val));
+        return val;
+    }
+
+    // checks the dbfs_* kernels against 20 * log10 and 10 * log10 for the accuracy documented in simd_math.hpp
+    // every normal exponent is covered with mantissas spaced by a prime, so the low bits vary, plus the ends of the
+    // mantissa range and both sides of the sqrt(2) split, inputs <= FLT_MIN have to give exactly the result for FLT_MIN
+    // returns the number of failed kernel and domain combinations
+    int check_dbfs(bool quiet)
+    {
+        constexpr double MAX_ERROR = 1e-4;  // dB
+
+        std::vector<float> input;
+        for(uint32_t exponent = 1; exponent < 255; ++exponent)
+        {
+            for(uint32_t mantissa = 0; mantissa < 0x800000; mantissa += 2039)
+                input.push_back(float_from_bits((exponent << 23) | mantissa));
+            for(uint32_t mantissa : { 1u, 0x3504f2u, 0x3504f3u, 0x3504f4u, 0x7ffffeu, 0x7fffffu })
+                input.push_back(float_from_bits((exponent << 23) | mantissa));
+        }
+        const auto num_normal = input.size();
+        for(uint32_t bits : { 0u, 1u, 0x400000u, 0x7fffffu,     // zero and denormals
+                              0x7fc00000u, 0x7fa00000u,         // quiet and signaling NaN
+                              0x80000000u, 0x80000001u, 0x807fffffu, 0x80800000u, 0xbf800000u, 0xff7fffffu, 0xff800000u,   // negatives
+                              0xffc00000u })
+            input.push_back(float_from_bits(bits));
+        input.resize((input.size() + 7) & ~(size_t)7, FLT_MIN);
+        std::vector<float> output(input.size());
+
+        struct Kernel
+        {
+            const char *name;
+            void (*func)(const float*, float*, size_t, float);
+        };
+        std::vector<Kernel> kernels = { { "dbfs_sse2", dbfs_buffer_sse2 } };
+        if(WAVSource::HAVE_AVX)
+            kernels.push_back({ "dbfs_avx", dbfs_buffer_avx });
+        if(WAVSource::HAVE_AVX2)
+            kernels.push_back({ "dbfs_avx2", dbfs_buffer_avx2 });
+
+        const struct
+        {
+            const char *name;
+            float db_per_ln;
+            double db_per_decade;
+        } domains[] = { { P_MAGNITUDE, simd_math::DB_PER_LN, 20.0 }, { P_POWER, simd_math::DB_PER_LN_POWER, 10.0 } };
+
+        auto failed = 0;
+        for(const auto& kernel : kernels)
+        {
+            for(const auto& domain : domains)
+            {
+                kernel.func(input.data(), output.data(), input.size(), domain.db_per_ln);
+                const auto floor = output[0];   // input[0] is FLT_MIN
+                auto worst = 0.0;
+                auto worst_input = 0.0f;
+                size_t bad_clamps = 0;
+                for(size_t i = 0; i < input.size(); ++i)
+                {
+                    if(i < num_normal)
+                    {
+                        // NaN compares false, so fail on it explicitly
+                        const auto err = std::abs((double)output[i] - (domain.db_per_decade * std::log10((double)input[i])));
+                        if(!(err <= worst))
+                        {
+                            worst = (err == err) ? err : INFINITY;
+                            worst_input = input[i];
+                        }
+                    }
+                    else if(std::memcmp(&output[i], &floor, sizeof(floor)) != 0)
+                    {
+                        if(bad_clamps++ == 0)
+                            std::fprintf(stderr, "FAIL %s, %s: input %g gave %g dB instead of %g dB\n", kernel.name, domain.name, input[i], output[i], floor);
+                    }
+                }
+
+                if((worst > MAX_ERROR) || (bad_clamps > 0))
+                {
+                    ++failed;
+                    if(worst > MAX_ERROR)
+                        std::fprintf(stderr, "FAIL %s, %s: max error %g dB at input %g\n", kernel.name, domain.name, worst, worst_input);
+                }
+                if(!quiet)
+                    std::fprintf(stderr, "%s vs log10, %s: max error %g dB over %zu inputs\n", kernel.name, domain.name, worst, num_normal);
+            }
+        }
+        return failed;
+    }
+
+    // runs audio through a scalar reference and every supported SIMD source at once and compares the per-bin dBFS
+    // returns the number of failed configurations
+    int check_isa(obs_data_t *settings, const Audio& audio, uint32_t fps, float tolerance, bool quiet)
+    {
+        const std::string name = std::string(AUDIO_SOURCE) + "-" + std::to_string(audio.channels.size());
+        obs_stub_set_audio_info(audio.sample_rate, layout_for(audio.channels.size()));
+        auto audio_source = obs_stub_create_audio_source(name.c_str());
+        obs_data_set_string(settings, P_AUDIO_SRC, name.c_str());
+        obs_data_set_int(settings, P_CUTOFF_LOW, 0);   // compare every bin, not just the displayed ones
+        obs_data_set_int(settings, P_CUTOFF_HIGH, audio.sample_rate);
+
+        std::vector<std::string> isas;
+        for(auto isa : { "sse2", "avx", "avx2" })
+            if(create_source(isa, settings) != nullptr)
+                isas.push_back(isa);
+        std::vector<float> worst(isas.size(), 0.0f);
+
+        const char *windows[] = { P_NONE, P_HANN, P_HAMMING, P_BLACKMAN, P_BLACKMAN_HARRIS };
+        const char *hops[][2] = { { P_NONE, P_WELCH }, { P_HOP_QUARTER, P_WELCH }, { P_HOP_QUARTER, P_MAX } };
+        auto failed = 0;
+        for(auto window : windows)
+        for(auto hop : hops)
+        for(auto smoothing = 0; smoothing < 3; ++smoothing)    // none, exponential, exponential with fast peaks
+        for(auto slope : { 0.0, 0.5 })
+        for(auto channel_mode : { P_MONO, P_STEREO })
+        for(auto domain : { P_MAGNITUDE, P_POWER })
+        for(auto interp : { P_LANCZOS, P_POINT })  // nearest neighbor only processes the sampled bins
+        {
+            obs_data_set_string(settings, P_WINDOW, window);
+            obs_data_set_string(settings, P_HOP_SIZE, hop[0]);
+            obs_data_set_string(settings, P_HOP_COMBINE, hop[1]);
+            obs_data_set_string(settings, P_TSMOOTHING, (smoothing > 0) ? P_EXPAVG : P_NONE);
+            obs_data_set_bool(settings, P_FAST_PEAKS, smoothing > 1);
+            obs_data_set_double(settings, P_SLOPE, slope);
+            obs_data_set_string(settings, P_CHANNEL_MODE, channel_mode);
+            obs_data_set_string(settings, P_DOMAIN, domain);
+            obs_data_set_string(settings, P_INTERP_MODE, interp);
+
+            auto reference = create_source("scalar", settings);
+            std::vector<std::unique_ptr<WAVSource>> sources;
+            for(const auto& isa : isas)
+                sources.push_back(create_source(isa, settings));
+
+            const auto num_channels = reference->spectrum_channels();
+            const auto size = reference->spectrum_size(true);
+            std::vector<float> expected(size);
+            std::vector<float> actual(size);
+            std::vector<float> diffs(isas.size(), 0.0f);
+            std::vector<const float*> planes(audio.channels.size());
+            const auto total = audio.channels[0].size();
+            uint64_t frames = 0;
+            for(size_t pos = 0; pos < total; ++frames)
+            {
+                const auto end = std::min<size_t>((size_t)(((frames + 1) * audio.sample_rate) / fps), total);
+                for(size_t ch = 0; ch < planes.size(); ++ch)
+                    planes[ch] = &audio.channels[ch][pos];
+                obs_stub_push_source_audio(audio_source, planes.data(), (uint32_t)(end - pos), false);
+                obs_stub_set_frame_time((frames * 1000000000ull) / fps);
+                pos = end;
+
+                reference->tick(1.0f / fps);
+                for(auto& source : sources)
+                    source->tick(1.0f / fps);
+
+                for(auto ch = 0u; ch < num_channels; ++ch)
+                {
+                    reference->read_spectrum(ch, expected.data(), true);
+                    for(size_t i = 0; i < sources.size(); ++i)
+                    {
+                        sources[i]->read_spectrum(ch, actual.data(), true);
+                        for(size_t bin = 0; bin < size; ++bin)
+                        {
+                            // NaN compares false, so fail on it explicitly
+                            const auto diff = std::abs(actual[bin] - expected[bin]);
+                            diffs[i] = std::max(diffs[i], (diff == diff) ? diff : INFINITY);
+                        }
+                    }
+                }
+            }
+
+            for(size_t i = 0; i < isas.size(); ++i)
+            {
+                worst[i] = std::max(worst[i], diffs[i]);
+                if(diffs[i] > tolerance)
+                {
+                    ++failed;
+                    std::fprintf(stderr, "FAIL %s: %zu ch input, window %s, hop %s/%s, %s%s, slope %.1f, %s, %s, %s: max diff %g dB\n",
+                                 isas[i].c_str(), audio.channels.size(), window, hop[0], hop[1], (smoothing > 0) ? P_EXPAVG : P_NONE,
+                                 (smoothing > 1) ? " + fast peaks" : "", slope, channel_mode, domain, interp, diffs[i]);
+                }
+            }
+        }
+
+        if(!quiet)
+            for(size_t i = 0; i < isas.size(); ++i)
+                std::fprintf(stderr, "%s vs scalar, %zu ch input: max diff %g dB\n", isas[i].c_str(), audio.channels.size(), worst[i]);
+        return failed;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string input;
+    std::string output;
+    std::string isa;
+    bool csv = true;
+    bool bins = false;
+    bool quiet = false;
+    bool raw = false;
+    bool check = false;
+    float tolerance = 0.001f;
+    SampleFormat raw_format = SampleFormat::F32;
+    uint32_t raw_rate = 48000;
+    uint32_t raw_channels = 2;
+    uint32_t fps = 60;
+
+    obs_stub_set_log_level(LOG_WARNING);
+    WAVSource::register_source();
+    const auto info = obs_stub_find_source_info(MODULE_NAME "_source");
+    auto settings = obs_data_create();
+    info->get_defaults(settings);
+
+    for(auto i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto has_value = i + 1 < argc;
+        if((arg == "-h") || (arg == "--help"))
+        {
+            std::fputs(USAGE, stdout);
+            return 0;
+        }
+        else if((arg == "-q") || (arg == "--quiet"))
+            quiet = true;
+        else if(arg == "--bins")
+            bins = true;
+        else if(arg == "--check-isa")
+            check = true;
+        else if(arg.empty() || (arg[0] != '-'))
+            input = arg;
+        else if(!has_value)
+        {
+            std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return 1;
+        }
+        else if((arg == "-o") || (arg == "--output"))
+            output = argv[++i];
+        else if(arg == "--format")
+        {
+            const std::string fmt = argv[++i];
+            if((fmt != "csv") && (fmt != "f32"))
+            {
+                std::fprintf(stderr, "unknown output format \"%s\"\n", fmt.c_str());
+                return 1;
+            }
+            csv = fmt == "csv";
+        }
+        else if(arg == "--fps")
+            fps = (uint32_t)std::max(std::atoi(argv[++i]), 1);
+        else if(arg == "--isa")
+            isa = argv[++i];
+        else if(arg == "--tolerance")
+            tolerance = std::strtof(argv[++i], nullptr);
+        else if(arg == "--raw")
+        {
+            raw = true;
+            if(!parse_format(argv[++i], raw_format))
+            {
+                std::fprintf(stderr, "unknown raw format \"%s\"\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(arg == "--rate")
+            raw_rate = (uint32_t)std::max(std::atoi(argv[++i]), 1);
+        else if(arg == "--channels")
+            raw_channels = (uint32_t)std::max(std::atoi(argv[++i]), 1);
+        else
+        {
+            apply_setting(settings, arg.c_str() + 2, argv[i + 1]);
+            ++i;
+        }
+    }
+    obs_data_set_bool(settings, P_AUTO_FFT_SIZE, false);
+    obs_data_set_bool(settings, P_ANALYSIS_THREAD, false);
+    obs_stub_set_video_fps(fps, 1);
+
+    // background measured plans would change the output mid run, keep the initial plans
+    FFTPlanner::get().shutdown();
+
+    if(check && input.empty())
+    {
+        auto failed = check_dbfs(quiet);
+        failed += check_isa(settings, synthetic_audio(1), fps, tolerance, quiet);
+        failed += check_isa(settings, synthetic_audio(2), fps, tolerance, quiet);
+        obs_data_release(settings);
+        return (failed > 0) ? 1 : 0;
+    }
+    if(input.empty())
+    {
+        std::fputs(USAGE, stderr);
+        return 1;
+    }
+
+    // load audio
+    std::vector<uint8_t> data;
+    if(!read_file(input.c_str(), data))
+    {
+        std::fprintf(stderr, "failed to read \"%s\"\n", input.c_str());
+        return 1;
+    }
+    Audio audio;
+    if(raw)
+    {
+        audio.sample_rate = raw_rate;
+        decode(data.data(), data.size() / (sample_bytes(raw_format) * raw_channels), raw_channels, raw_format, audio);
+    }
+    else
+    {
+        std::string error;
+        if(!parse_wav(data, audio, error))
+        {
+            std::fprintf(stderr, "\"%s\": %s\n", input.c_str(), error.c_str());
+            return 1;
+        }
+    }
+    data.clear();
+    data.shrink_to_fit();
+    const auto layout = layout_for(audio.channels.size());
+    if(layout == SPEAKERS_UNKNOWN)
+    {
+        std::fprintf(stderr, "unsupported channel count %zu\n", audio.channels.size());
+        return 1;
+    }
+
+    if(check)
+    {
+        const auto failed = check_dbfs(quiet) + check_isa(settings, audio, fps, tolerance, quiet);
+        obs_data_release(settings);
+        return (failed > 0) ? 1 : 0;
+    }
+
+    obs_stub_set_audio_info(audio.sample_rate, layout);
+    auto audio_source = obs_stub_create_audio_source(AUDIO_SOURCE);
+    obs_data_set_string(settings, P_AUDIO_SRC, AUDIO_SOURCE);
+
+    // sources only process the bins between the cutoffs
+    if(bins)
+    {
+        obs_data_set_int(settings, P_CUTOFF_LOW, 0);
+        obs_data_set_int(settings, P_CUTOFF_HIGH, audio.sample_rate);
+    }
+
+    std::unique_ptr<WAVSource> source;
+    if(isa.empty())
+        source.reset(static_cast<WAVSource*>(info->create(settings, nullptr)));
+    else
+        source = create_source(isa, settings);
+    if(source == nullptr)
+    {
+        std::fprintf(stderr, "instruction set \"%s\" is unknown or not supported by this CPU\n", isa.c_str());
+        return 1;
+    }
+
+    const auto num_channels = source->spectrum_channels();
+    const auto size = source->spectrum_size(bins);
+    if(num_channels == 0)
+    {
+        std::fprintf(stderr, "meter display modes have no spectrum\n");
+        return 1;
+    }
+
+    auto out = stdout;
+    if(!output.empty())
+    {
+        out = std::fopen(output.c_str(), csv ? "w" : "wb");
+        if(out == nullptr)
+        {
+            std::fprintf(stderr, "failed to open \"%s\" for writing\n", output.c_str());
+            return 1;
+        }
+    }
+
+    // frame n gets samples [n * rate / fps, (n + 1) * rate / fps), like OBS delivering audio at video rate
+    const auto total = audio.channels[0].size();
+    const auto seconds = 1.0f / (float)fps;
+    std::vector<std::vector<float>> spectra(num_channels, std::vector<float>(size));
+    std::vector<const float*> planes(audio.channels.size());
+    uint64_t frames = 0;
+    size_t pos = 0;
+    double analysis_ns = 0.0;
+    while(pos < total)
+    {
+        const auto end = std::min<size_t>((size_t)(((frames + 1) * audio.sample_rate) / fps), total);
+        for(size_t ch = 0; ch < planes.size(); ++ch)
+            planes[ch] = &audio.channels[ch][pos];
+
+        // timed: capture, window, fft, smoothing, dB and interpolation; not the output formatting
+        const auto start = std::chrono::steady_clock::now();
+        obs_stub_push_source_audio(audio_source, planes.data(), (uint32_t)(end - pos), false);
+        obs_stub_set_frame_time((frames * 1000000000ull) / fps);
+        source->tick(seconds);
+        for(auto ch = 0u; ch < num_channels; ++ch)
+            source->read_spectrum(ch, spectra[ch].data(), bins);
+        analysis_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        for(auto ch = 0u; ch < num_channels; ++ch)
+        {
+            if(csv)
+            {
+                std::fprintf(out, "%llu,%u", (unsigned long long)frames, ch);
+                for(auto val : spectra[ch])
+                    std::fprintf(out, ",%.6g", val);
+                std::fputc('\n', out);
+            }
+            else
+                std::fwrite(spectra[ch].data(), sizeof(float), size, out);
+        }
+
+        pos = end;
+        ++frames;
+    }
+
+    if(out != stdout)
+        std::fclose(out);
+    const auto stage_times = source->stats().to_string();
+    source.reset();
+    obs_data_release(settings);
+
+    if(!quiet)
+    {
+        const auto audio_seconds = (double)total / audio.sample_rate;
+        const auto analysis_seconds = analysis_ns * 1e-9;
+        std::fprintf(stderr, "%llu frames, %u channel(s) of %zu values, %.2f s of audio\n", (unsigned long long)frames, num_channels, size, audio_seconds);
+        std::fprintf(stderr, "analysis: %.3f s, %.0f frames/sec, %.1fx realtime\n", analysis_seconds, frames / analysis_seconds, audio_seconds / analysis_seconds);
+        std::fprintf(stderr, "stage times p50/p99/max (us): %s\n", stage_times.c_str());
+    }
+    return 0;
+}